@@ -0,0 +1,67 @@
+#include "AGC.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+AGC::AGC(float sampleRate, unsigned int lookaheadMs, const SIMDKernels& simdKernels)
+    : kernels(simdKernels), sampleRate(sampleRate) {
+    envelope = targetLevel;     // start with gain 1
+    holdSamples = static_cast<unsigned int>(holdTime * sampleRate);
+    releaseFactor = std::exp(-static_cast<float>(SUBBLOCK) / (releaseTime * sampleRate));
+    setLookahead(lookaheadMs);
+}
+
+void AGC::setLookahead(unsigned int lookaheadMs) {
+    lookaheadMs = std::min(lookaheadMs, MAX_LOOKAHEAD_MS);
+    lookahead = static_cast<unsigned int>(lookaheadMs * sampleRate / 1000.0f);
+    delayLine.assign(lookahead, 0.0f);
+}
+
+// one sub-block: level detection on the new samples in, gain applied to the (delayed) samples out
+void AGC::processChunk(const float *in, float *out, unsigned int len) {
+    float peak = kernels.peakAbs(in, len);
+
+    if (peak >= envelope) {
+        // attack: follow the peak immediately and restart the hold time
+        envelope = peak;
+        holdCounter = holdSamples;
+    } else if (holdCounter > 0) {
+        holdCounter = holdCounter > len ? holdCounter - len : 0;
+    } else {
+        // release
+        float f = len == SUBBLOCK ? releaseFactor : std::exp(-static_cast<float>(len) / (releaseTime * sampleRate));
+        envelope = std::max(envelope * f, peak);
+    }
+
+    float newGain = targetLevel / std::max(envelope, targetLevel / maxGain);
+    newGain = std::max(newGain, 1.0f);
+
+    // ramp from the old to the new gain, no steps in the audio
+    kernels.gainRamp(out, len, gain, (newGain - gain) / len, clipLevel);
+    gain = newGain;
+}
+
+void AGC::process(float *audio, unsigned int numSamples) {
+    if (lookahead == 0) {
+        for (unsigned int pos = 0; pos < numSamples; pos += SUBBLOCK) {
+            unsigned int len = std::min(SUBBLOCK, numSamples - pos);
+            processChunk(audio + pos, audio + pos, len);
+        }
+        return;
+    }
+
+    // work = delay line + new samples, the gain for input sample i is applied to work[i],
+    // which is the sample 'lookahead' samples before it
+    work.resize(lookahead + numSamples);
+    std::memcpy(work.data(), delayLine.data(), lookahead * sizeof(float));
+    std::memcpy(work.data() + lookahead, audio, numSamples * sizeof(float));
+
+    for (unsigned int pos = 0; pos < numSamples; pos += SUBBLOCK) {
+        unsigned int len = std::min(SUBBLOCK, numSamples - pos);
+        processChunk(work.data() + lookahead + pos, work.data() + pos, len);
+    }
+
+    // the samples after the processed part are the new delay line
+    std::memcpy(audio, work.data(), numSamples * sizeof(float));
+    std::memcpy(delayLine.data(), work.data() + numSamples, lookahead * sizeof(float));
+}
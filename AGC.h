@@ -0,0 +1,52 @@
+#ifndef AGC_H
+#define AGC_H
+
+#include <vector>
+#include "SIMDKernels.h"
+
+// block based AGC for the 48 kS/s audio of one client (one object per SignalDecoder)
+// the peak level of every 1 ms sub-block drives an envelope follower with instant attack,
+// hold and exponential release. The gain is ramped linearly over the sub-block,
+// so the per sample work is a vectorized peak search and multiply.
+// With lookahead the audio is delayed, the gain is then already reduced when a loud signal arrives.
+class AGC {
+public:
+    static constexpr unsigned int SUBBLOCK = 48;            // 1 ms at 48 kS/s
+    static constexpr unsigned int MAX_LOOKAHEAD_MS = 20;    // must be shorter than the hold time
+
+    explicit AGC(float sampleRate = 48000.0f, unsigned int lookaheadMs = 0,
+                 const SIMDKernels& simdKernels = getSIMDKernels());
+
+    // in place, the output is delayed by the lookahead time
+    void process(float *audio, unsigned int numSamples);
+
+    // lookahead 0...MAX_LOOKAHEAD_MS milliseconds, 0 = no delay
+    void setLookahead(unsigned int lookaheadMs);
+
+    float getGain() const { return gain; }
+
+private:
+    void processChunk(const float *in, float *out, unsigned int len);
+
+    const SIMDKernels& kernels;
+    float sampleRate;
+
+    const float targetLevel = 0.3f;     // Desired signal level
+    const float maxGain = 1000.0f;      // Maximum allowed gain
+    const float clipLevel = 0.99f;
+    const float holdTime = 0.25f;       // s, gain is kept after a peak (no pumping between syllables)
+    const float releaseTime = 0.4f;     // s, time constant of the gain recovery
+
+    float envelope;
+    float gain = 1.0f;
+    unsigned int holdSamples = 0;
+    unsigned int holdCounter = 0;
+    float releaseFactor;                // envelope decay per full sub-block
+
+    // lookahead: delay line and working buffer (delay line followed by the new samples)
+    unsigned int lookahead = 0;
+    std::vector<float> delayLine;
+    std::vector<float> work;
+};
+
+#endif // AGC_H
@@ -0,0 +1,111 @@
+#include "AudioCodec.h"
+#include <cstring>
+
+// IMA-ADPCM tables
+static const int16_t imaStepTable[89] = {
+    7, 8, 9, 10, 11, 12, 13, 14, 16, 17, 19, 21, 23, 25, 28, 31, 34, 37, 41, 45,
+    50, 55, 60, 66, 73, 80, 88, 97, 107, 118, 130, 143, 157, 173, 190, 209, 230,
+    253, 279, 307, 337, 371, 408, 449, 494, 544, 598, 658, 724, 796, 876, 963,
+    1060, 1166, 1282, 1411, 1552, 1707, 1878, 2066, 2272, 2499, 2749, 3024, 3327,
+    3660, 4026, 4428, 4871, 5358, 5894, 6484, 7132, 7845, 8630, 9493, 10442,
+    11487, 12635, 13899, 15289, 16818, 18500, 20350, 22385, 24623, 27086, 29794, 32767
+};
+
+static const int8_t imaIndexTable[16] = {
+    -1, -1, -1, -1, 2, 4, 6, 8,
+    -1, -1, -1, -1, 2, 4, 6, 8
+};
+
+AudioEncoder::AudioEncoder(const SIMDKernels& simdKernels) : kernels(simdKernels) {
+}
+
+bool AudioEncoder::setCodec(int value) {
+    if (value < static_cast<int>(AudioCodec::FLOAT32) || value > static_cast<int>(AudioCodec::ADPCM)) {
+        return false;
+    }
+    codec = static_cast<AudioCodec>(value);
+    adpcmPredictor = 0;
+    adpcmIndex = 0;
+    return true;
+}
+
+void AudioEncoder::encode(const float *samples, unsigned int n, ClientTXData &txdata) {
+    if (n > AudioFramer::MAX_FRAME_SIZE) n = AudioFramer::MAX_FRAME_SIZE;
+    // the payload follows the ID in the float array
+    uint8_t *payload = reinterpret_cast<uint8_t*>(&txdata.data[1]);
+    unsigned int bytes = 0;
+
+    switch (codec) {
+        case AudioCodec::FLOAT32:
+            txdata.data[0] = AUDIO_ID_FLOAT32;
+            std::memcpy(payload, samples, n * sizeof(float));
+            bytes = n * sizeof(float);
+            break;
+
+        case AudioCodec::INT16:
+            txdata.data[0] = AUDIO_ID_INT16;
+            kernels.floatToInt16(samples, n, pcm.data());
+            std::memcpy(payload, pcm.data(), n * sizeof(int16_t));
+            bytes = n * sizeof(int16_t);
+            break;
+
+        case AudioCodec::MULAW:
+            txdata.data[0] = AUDIO_ID_MULAW;
+            kernels.floatToMuLaw(samples, n, payload);
+            bytes = n;
+            break;
+
+        case AudioCodec::ADPCM:
+            txdata.data[0] = AUDIO_ID_ADPCM;
+            kernels.floatToInt16(samples, n, pcm.data());
+            bytes = encodeADPCM(pcm.data(), n, payload);
+            break;
+    }
+
+    txdata.length = sizeof(float) + bytes;
+}
+
+// the prediction is sequential, only the conversion to int16 is vectorized
+unsigned int AudioEncoder::encodeADPCM(const int16_t *in, unsigned int n, uint8_t *out) {
+    // header: state of the decoder at the start of this packet
+    int16_t pred = static_cast<int16_t>(adpcmPredictor);
+    std::memcpy(out, &pred, sizeof(pred));
+    out[2] = static_cast<uint8_t>(adpcmIndex);
+    out[3] = 0;
+    uint8_t *data = out + 4;
+
+    int predictor = adpcmPredictor;
+    int index = adpcmIndex;
+    for (unsigned int i = 0; i < n; i++) {
+        int step = imaStepTable[index];
+        int diff = in[i] - predictor;
+        int code = 0;
+        if (diff < 0) {
+            code = 8;
+            diff = -diff;
+        }
+
+        // 3 bit quantization of diff / step, the decoder reconstructs diffq the same way
+        int diffq = step >> 3;
+        if (diff >= step) { code |= 4; diff -= step; diffq += step; }
+        step >>= 1;
+        if (diff >= step) { code |= 2; diff -= step; diffq += step; }
+        step >>= 1;
+        if (diff >= step) { code |= 1; diffq += step; }
+
+        predictor += (code & 8) ? -diffq : diffq;
+        if (predictor > 32767) predictor = 32767;
+        else if (predictor < -32768) predictor = -32768;
+
+        index += imaIndexTable[code];
+        if (index < 0) index = 0;
+        else if (index > 88) index = 88;
+
+        if (i & 1) data[i >> 1] |= static_cast<uint8_t>(code << 4);
+        else data[i >> 1] = static_cast<uint8_t>(code);
+    }
+
+    adpcmPredictor = predictor;
+    adpcmIndex = index;
+    return 4 + (n + 1) / 2;
+}
@@ -0,0 +1,54 @@
+#ifndef AUDIO_CODEC_H
+#define AUDIO_CODEC_H
+
+#include <array>
+#include <cstdint>
+#include "global.h"
+#include "SIMDKernels.h"
+#include "AudioFramer.h"
+
+// audio formats on the WebSocket, selected by the browser (message ID 6)
+// the first float of the packet is the ID, followed by the encoded samples:
+//   3 ... float32 (default, 4 bytes per sample)
+//   6 ... int16 little endian (2 bytes)
+//   7 ... G.711 mu-law (1 byte)
+//   8 ... IMA-ADPCM (4 bits): int16 predictor, uint8 step index, uint8 0, then two samples per byte, low nibble first
+//         every packet starts with the decoder state, so it can be decoded without the previous packets
+enum class AudioCodec {
+    FLOAT32 = 0,
+    INT16 = 1,
+    MULAW = 2,
+    ADPCM = 3
+};
+
+const float AUDIO_ID_FLOAT32 = 3.0f;
+const float AUDIO_ID_INT16 = 6.0f;
+const float AUDIO_ID_MULAW = 7.0f;
+const float AUDIO_ID_ADPCM = 8.0f;
+
+// encoder of one client
+class AudioEncoder {
+public:
+    explicit AudioEncoder(const SIMDKernels& simdKernels = getSIMDKernels());
+
+    // 0...3 (see AudioCodec), returns false for other values
+    bool setCodec(int codec);
+    AudioCodec getCodec() const { return codec; }
+
+    // encode n samples (-1...1, n <= AudioFramer::MAX_FRAME_SIZE) into txdata.data, sets txdata.length
+    void encode(const float *samples, unsigned int n, ClientTXData &txdata);
+
+private:
+    unsigned int encodeADPCM(const int16_t *pcm, unsigned int n, uint8_t *out);
+
+    const SIMDKernels& kernels;
+    AudioCodec codec = AudioCodec::FLOAT32;
+
+    std::array<int16_t, AudioFramer::MAX_FRAME_SIZE> pcm;
+
+    // IMA-ADPCM state, continues over the packets
+    int adpcmPredictor = 0;
+    int adpcmIndex = 0;
+};
+
+#endif // AUDIO_CODEC_H
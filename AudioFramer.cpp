@@ -0,0 +1,47 @@
+#include "AudioFramer.h"
+#include <algorithm>
+#include <cstring>
+
+bool AudioFramer::setFrameSize(unsigned int size) {
+    switch (size) {
+        case 128:
+        case 256:
+        case 512:
+        case 1024:
+            frameSize = size;
+            return true;
+    }
+    return false;
+}
+
+void AudioFramer::write(const float *samples, unsigned int n) {
+    if (n > CAPACITY) {
+        // keep only the newest samples
+        dropped += n - CAPACITY;
+        samples += n - CAPACITY;
+        n = CAPACITY;
+    }
+    if (available() + n > CAPACITY) {
+        unsigned int excess = available() + n - CAPACITY;
+        readPos += excess;
+        dropped += excess;
+    }
+
+    // at most two copies: up to the end of the ring and from the start
+    unsigned int start = static_cast<unsigned int>(writePos & MASK);
+    unsigned int first = std::min(n, CAPACITY - start);
+    std::memcpy(&ring[start], samples, first * sizeof(float));
+    std::memcpy(&ring[0], samples + first, (n - first) * sizeof(float));
+    writePos += n;
+}
+
+bool AudioFramer::readFrame(float *out) {
+    if (available() < frameSize) return false;
+
+    unsigned int start = static_cast<unsigned int>(readPos & MASK);
+    unsigned int first = std::min(frameSize, CAPACITY - start);
+    std::memcpy(out, &ring[start], first * sizeof(float));
+    std::memcpy(out + first, &ring[0], (frameSize - first) * sizeof(float));
+    readPos += frameSize;
+    return true;
+}
@@ -0,0 +1,42 @@
+#ifndef AUDIO_FRAMER_H
+#define AUDIO_FRAMER_H
+
+#include <array>
+#include <cstdint>
+
+// collects the 8 kS/s audio of one client and cuts it into frames for the WebSocket
+// the frame size is set by the browser: small frames give less delay (128 samples = 16 ms),
+// large frames fewer packets. Ring buffer, samples are never moved.
+// used by the task of one client only, so no locking
+class AudioFramer {
+public:
+    static constexpr unsigned int CAPACITY = 4096;           // power of 2, 512 ms at 8 kS/s
+    static constexpr unsigned int MAX_FRAME_SIZE = 1024;     // fits into ClientTXData
+    static constexpr unsigned int DEFAULT_FRAME_SIZE = 1024;
+
+    // 128, 256, 512 or 1024 samples, returns false for other values
+    bool setFrameSize(unsigned int size);
+    unsigned int getFrameSize() const { return frameSize; }
+
+    // append samples, the oldest samples are dropped if the browser does not keep up
+    void write(const float *samples, unsigned int n);
+
+    // copy one frame to out if enough samples are available
+    bool readFrame(float *out);
+
+    unsigned int available() const { return static_cast<unsigned int>(writePos - readPos); }
+
+    // samples dropped because the buffer was full
+    uint64_t getDropped() const { return dropped; }
+
+private:
+    static constexpr unsigned int MASK = CAPACITY - 1;
+
+    std::array<float, CAPACITY> ring{};
+    uint64_t readPos = 0;       // running positions, the ring index is pos & MASK
+    uint64_t writePos = 0;
+    unsigned int frameSize = DEFAULT_FRAME_SIZE;
+    uint64_t dropped = 0;
+};
+
+#endif // AUDIO_FRAMER_H
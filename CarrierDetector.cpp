@@ -0,0 +1,70 @@
+#include "CarrierDetector.h"
+#include <algorithm>
+#include <cmath>
+
+void CarrierDetector::detect(const float *power, unsigned int n, float binHz, std::vector<Carrier>& carriers) {
+    carriers.clear();
+    if (n == 0) return;
+
+    // noise floor of each block, O(n) with nth_element
+    const unsigned int numBlocks = (n + NOISE_BLOCK - 1) / NOISE_BLOCK;
+    blockFloor.resize(numBlocks);
+    for (unsigned int b = 0; b < numBlocks; b++) {
+        unsigned int first = b * NOISE_BLOCK;
+        unsigned int len = std::min(NOISE_BLOCK, n - first);
+        scratch.assign(power + first, power + first + len);
+        auto q = scratch.begin() + static_cast<size_t>(NOISE_QUANTILE * (len - 1));
+        std::nth_element(scratch.begin(), q, scratch.end());
+        blockFloor[b] = *q;
+    }
+
+    // linear between the block centers
+    noise.resize(n);
+    for (unsigned int i = 0; i < n; i++) {
+        float pos = (static_cast<float>(i) + 0.5f) / NOISE_BLOCK - 0.5f;
+        int b = std::min(std::max(static_cast<int>(std::floor(pos)), 0), static_cast<int>(numBlocks) - 1);
+        int b2 = std::min(b + 1, static_cast<int>(numBlocks) - 1);
+        float t = std::min(std::max(pos - b, 0.0f), 1.0f);
+        noise[i] = blockFloor[b] + t * (blockFloor[b2] - blockFloor[b]);
+    }
+
+    const float detectFactor = std::pow(10.0f, DETECT_DB / 10.0f);
+    const float edgeFactor = std::pow(10.0f, EDGE_DB / 10.0f);
+
+    // runs above the edge threshold, short gaps are bridged
+    unsigned int i = 0;
+    while (i < n) {
+        if (power[i] <= noise[i] * edgeFactor) {
+            i++;
+            continue;
+        }
+
+        unsigned int first = i, last = i, gap = 0;
+        float peakRatio = 0.0f, sum = 0.0f, weighted = 0.0f;
+        for (; i < n && gap <= MERGE_GAP; i++) {
+            if (power[i] > noise[i] * edgeFactor) {
+                last = i;
+                gap = 0;
+                sum += power[i];
+                weighted += power[i] * i;
+                peakRatio = std::max(peakRatio, power[i] / std::max(noise[i], 1e-30f));
+            } else {
+                gap++;
+            }
+        }
+        i = last + 1;
+
+        if (peakRatio > detectFactor) {
+            carriers.push_back({weighted / sum * binHz, (last - first + 1) * binHz, 10.0f * std::log10(peakRatio)});
+        }
+    }
+
+    // only the strongest, in the order of their frequency
+    if (carriers.size() > MAX_CARRIERS) {
+        std::nth_element(carriers.begin(), carriers.begin() + MAX_CARRIERS, carriers.end(),
+                         [](const Carrier& a, const Carrier& b) { return a.snr > b.snr; });
+        carriers.resize(MAX_CARRIERS);
+        std::sort(carriers.begin(), carriers.end(),
+                  [](const Carrier& a, const Carrier& b) { return a.frequency < b.frequency; });
+    }
+}
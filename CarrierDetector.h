@@ -0,0 +1,38 @@
+#ifndef CARRIER_DETECTOR_H
+#define CARRIER_DETECTOR_H
+
+#include <vector>
+#include <memory>
+
+// active signal in the spectrum of a virtual band
+struct Carrier {
+    float frequency;    // Hz above the band start, power weighted center
+    float bandwidth;    // Hz
+    float snr;          // dB, peak against the noise floor
+};
+
+typedef std::shared_ptr<const std::vector<Carrier>> CarrierList;
+
+// carrier detection in the averaged power spectrum of the FFTProcessor (ordered statistic CFAR):
+// the noise floor of every NOISE_BLOCK bins is a low quantile of their power, interpolated between the blocks,
+// a carrier is a run of bins above the noise floor + EDGE_DB with a peak above the noise floor + DETECT_DB
+class CarrierDetector {
+public:
+    static const unsigned int NOISE_BLOCK = 128;
+    static constexpr float NOISE_QUANTILE = 0.3f;   // robust against the carriers within a block
+    static constexpr float DETECT_DB = 10.0f;
+    static constexpr float EDGE_DB = 3.0f;
+    static const unsigned int MERGE_GAP = 2;        // runs closer than this many bins are one carrier
+    static const unsigned int MAX_CARRIERS = 100;   // the strongest, must fit into a ClientTXData
+
+    // power: n linear bins of binHz each, bin 0 is the band start
+    // carriers: sorted by frequency
+    void detect(const float *power, unsigned int n, float binHz, std::vector<Carrier>& carriers);
+
+private:
+    std::vector<float> noise;       // noise floor of every bin
+    std::vector<float> blockFloor;
+    std::vector<float> scratch;
+};
+
+#endif // CARRIER_DETECTOR_H
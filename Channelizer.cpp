@@ -0,0 +1,97 @@
+#include "Channelizer.h"
+#include "FFTPlanCache.h"
+#include <cstring>
+#include <algorithm>
+#include <iostream>
+
+// one instance per virtual band
+Channelizer& Channelizer::getInstance(int vband) {
+    static Channelizer instances[MAX_VBANDS];
+    return instances[vband];
+}
+
+// Constructor
+Channelizer::Channelizer() : framePool(CHANNELIZER_FFT_SIZE, 128) {
+    fftIn = (fftwf_complex*) fftwf_malloc(sizeof(fftwf_complex) * CHANNELIZER_FFT_SIZE);
+    fftOut = (fftwf_complex*) fftwf_malloc(sizeof(fftwf_complex) * CHANNELIZER_FFT_SIZE);
+    fftPlan = FFTPlanCache::getInstance().getPlan(CHANNELIZER_FFT_SIZE, FFTW_FORWARD);
+
+    designSliceFilter();
+
+    // clear the input buffer, the first overlap contains zeros
+    std::memset(fftIn, 0, sizeof(fftwf_complex) * CHANNELIZER_FFT_SIZE);
+}
+
+// Destructor
+Channelizer::~Channelizer() {
+    if (fftIn) {
+        fftwf_free(fftIn);
+        fftIn = nullptr;
+    }
+    if (fftOut) {
+        fftwf_free(fftOut);
+        fftOut = nullptr;
+    }
+}
+
+// the channel filter is a lowpass at 480 kS/s which also acts as anti-alias filter for the decimation to 48 kS/s
+// its length must not exceed CHANNELIZER_OVERLAP + 1, otherwise the overlap-save output gets circular aliasing
+void Channelizer::designSliceFilter() {
+    const unsigned int taps = CHANNELIZER_OVERLAP + 1;
+    const float fc = 21000.0f / 480000.0f;  // passband up to approx. 20 kHz, stopband starts below 24 kHz
+    std::vector<float> h(taps);
+    liquid_firdes_kaiser(taps, fc, 60.0f, 0.0f, h.data());
+
+    // normalize to unity gain at DC
+    float sum = 0.0f;
+    for (float v : h) sum += v;
+
+    std::memset(fftIn, 0, sizeof(fftwf_complex) * CHANNELIZER_FFT_SIZE);
+    for (unsigned int i = 0; i < taps; i++) {
+        fftIn[i][0] = h[i] / sum;
+        fftIn[i][1] = 0.0f;
+    }
+    fftwf_execute_dft(fftPlan, fftIn, fftOut);
+
+    // keep the bins -IFFT_SIZE/2 ... IFFT_SIZE/2-1 in IFFT order
+    // and include the 1/N scaling of the (unnormalized) inverse FFT
+    const float scale = 1.0f / CHANNELIZER_FFT_SIZE;
+    sliceFilter.resize(CHANNELIZER_IFFT_SIZE);
+    for (int j = 0; j < CHANNELIZER_IFFT_SIZE; j++) {
+        int k = (j < CHANNELIZER_IFFT_SIZE / 2) ? j : CHANNELIZER_FFT_SIZE - (CHANNELIZER_IFFT_SIZE - j);
+        sliceFilter[j] = liquid_float_complex(fftOut[k][0] * scale, fftOut[k][1] * scale);
+    }
+}
+
+// collects the samples into the FFT input buffer
+// every CHANNELIZER_HOP samples a new spectrum is calculated
+void Channelizer::processSamples(const liquid_float_complex* samples, size_t numSamples, std::vector<SampleBlockPtr>& frames) {
+    size_t pos = 0;
+    while (pos < numSamples) {
+        size_t len = std::min(numSamples - pos, static_cast<size_t>(CHANNELIZER_FFT_SIZE - fillLevel));
+        std::memcpy(&fftIn[fillLevel], &samples[pos], len * sizeof(fftwf_complex));
+        fillLevel += len;
+        pos += len;
+
+        if (fillLevel == CHANNELIZER_FFT_SIZE) {
+            // out-of-place complex FFT, the input buffer is preserved
+            fftwf_execute_dft(fftPlan, fftIn, fftOut);
+
+            SampleBlockPtr frame = framePool.acquire();
+            if (frame) {
+                SampleBlock* b = frame.get();
+                b->sequence = blockIndex;
+                b->numSamples = CHANNELIZER_FFT_SIZE;
+                std::memcpy(static_cast<void*>(b->sdata), fftOut, CHANNELIZER_FFT_SIZE * sizeof(fftwf_complex));
+                frames.push_back(std::move(frame));
+            } else {
+                std::cerr << "Channelizer: no free frame, spectrum dropped" << std::endl;
+            }
+            blockIndex++;
+
+            // the last samples are the overlap of the next block
+            std::memmove(&fftIn[0], &fftIn[CHANNELIZER_HOP], CHANNELIZER_OVERLAP * sizeof(fftwf_complex));
+            fillLevel = CHANNELIZER_OVERLAP;
+        }
+    }
+}
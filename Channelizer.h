@@ -0,0 +1,59 @@
+#ifndef CHANNELIZER_H
+#define CHANNELIZER_H
+
+#include <vector>
+#include <memory>
+#include <complex>
+#include <cstdint>
+#include <fftw3.h>
+#include "liquid.h"
+#include "SampleBlock.h"
+#include "VirtualBands.h"
+
+// Overlap-save fast-convolution downconverter
+// one forward FFT of the 480 kS/s stream is shared by all clients,
+// every client only picks its slice of bins and runs a small inverse FFT (see Tuner)
+const int CHANNELIZER_FFT_SIZE = 4800;                                          // 100 Hz per bin at 480 kS/s
+const int CHANNELIZER_OVERLAP = 1200;                                           // 1/4 overlap, max. filter length + 1
+const int CHANNELIZER_HOP = CHANNELIZER_FFT_SIZE - CHANNELIZER_OVERLAP;         // new samples per FFT
+const int CHANNELIZER_DECIMATION = 10;                                          // 480 kS/s to 48 kS/s
+const int CHANNELIZER_IFFT_SIZE = CHANNELIZER_FFT_SIZE / CHANNELIZER_DECIMATION;
+const int CHANNELIZER_DISCARD = CHANNELIZER_OVERLAP / CHANNELIZER_DECIMATION;   // invalid output samples per IFFT
+const float CHANNELIZER_BIN_HZ = 480000.0f / CHANNELIZER_FFT_SIZE;
+
+class Channelizer {
+public:
+    // one instance per virtual band, the slice filter is the same for all
+    static Channelizer& getInstance(int vband = 0);
+
+    // feed 480 kS/s samples, the spectra which became complete are appended to frames
+    // every frame is a SampleBlock of CHANNELIZER_FFT_SIZE bins (FFT order),
+    // its sequence is the block index which is needed for the phase correction
+    void processSamples(const liquid_float_complex* samples, size_t numSamples, std::vector<SampleBlockPtr>& frames);
+
+    // frequency response of the channel filter for CHANNELIZER_IFFT_SIZE bins
+    // in IFFT order and already scaled by 1/CHANNELIZER_FFT_SIZE
+    const std::vector<liquid_float_complex>& getSliceFilter() const { return sliceFilter; }
+
+private:
+    Channelizer();
+    ~Channelizer();
+
+    Channelizer(const Channelizer&) = delete;
+    Channelizer& operator=(const Channelizer&) = delete;
+
+    void designSliceFilter();
+
+    fftwf_plan fftPlan = nullptr;       // shared plan of the FFTPlanCache
+    fftwf_complex* fftIn = nullptr;
+    fftwf_complex* fftOut = nullptr;
+    int fillLevel = CHANNELIZER_OVERLAP;    // the first overlap is zero
+    uint64_t blockIndex = 0;
+
+    // spectra are shared (read only) by all ClientObjects
+    SampleBlockPool framePool;
+
+    std::vector<liquid_float_complex> sliceFilter;
+};
+
+#endif // CHANNELIZER_H
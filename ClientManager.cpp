@@ -1,5 +1,8 @@
 #include "ClientManager.h"
 #include "WebSocketServer.h"
+#include "Channelizer.h"
+#include "FFTProcessor.h"
+#include "DSPThreadPool.h"
 #include <iostream>
 #include <chrono>
 #include <thread>
@@ -21,25 +24,41 @@ void ClientManager::startProcessing() {
 
 // get number of active clients
 int ClientManager::getNumberOfLoggedInClients() {
-    return clientMap.size();
+    return numClients;
 }
 
 // Function for WebSocketServer to push client info into the queue
 // used by the WebSocket to send User data to the ClientObject (e.g., tuning, mode...)
 bool ClientManager::enqueueClientInfo(const ClientInfo& clientInfo) {
-    return clientQueue.push(clientInfo);  // Push data to the lock-free queue
+    bool ret = clientQueue.push(clientInfo);  // Push data to the lock-free queue
+    notifier.notify();
+    return ret;
 }
 
 // Function to enqueue raw sample data
 // use to send 480kS/s raw samples to the ClientObject for demodulation and smallFFT
-bool ClientManager::enqueueRawSamples(const SampleData& sampleData) {
-    return rawSamplesQueue.push(sampleData);  // Push raw sample data to the queue
+bool ClientManager::enqueueRawSamples(int vband, const SampleBlockPtr& sampleBlock) {
+    bool ret = rawSamplesQueue[vband].push(sampleBlock);  // Push the handle, the samples are not copied
+    notifier.notify();
+    return ret;
 }
 
 // Function to enqueue FFT data into the bigFFTqueue
-// the FFTProcessor Object uses this function to send its data to all clients via the bigFFTqueue
-bool ClientManager::enqueueFFTData(const std::array<float, 1025>& fftData) {
-    return bigFFTqueue.push(fftData);  // Push FFT data to the queue
+// the FFTProcessor Objects use this function to send their data to the clients of their virtual band
+bool ClientManager::enqueueFFTData(int vband, const std::array<float, 1025>& fftData,
+                                   std::shared_ptr<const std::vector<float>> fullSpectrum,
+                                   SpectrumPyramidPtr pyramid, CarrierList carriers) {
+    bool ret = bigFFTqueue[vband].push({fftData, std::move(fullSpectrum), std::move(pyramid), std::move(carriers)});  // Push FFT data to the queue
+    notifier.notify();
+    return ret;
+}
+
+bool ClientManager::hasInput() {
+    if (clientQueue.read_available()) return true;
+    for (int vband = 0; vband < MAX_VBANDS; vband++) {
+        if (rawSamplesQueue[vband].read_available() || bigFFTqueue[vband].read_available()) return true;
+    }
+    return false;
 }
 
 // Internal method to process messages from the SPSC queue
@@ -56,7 +75,8 @@ void ClientManager::processMessages() {
 
                     if(clientMap.size() < max_users) {
                         // Create and start a new ClientObject
-                        clientMap[clientInfo.clientId] = std::make_unique<ClientObject>(clientInfo.clientId, clientInfo.clientIP);
+                        clientMap[clientInfo.clientId] = std::make_shared<ClientObject>(clientInfo.clientId, clientInfo.clientIP, clientInfo.txQueue);
+                        numClients = clientMap.size();
                         //printf("Inserted Client %d into the ClientMap\n",clientInfo.clientId);
                     }
                     break;
@@ -68,8 +88,10 @@ void ClientManager::processMessages() {
                     // Stop and remove the ClientObject
                     auto it = clientMap.find(clientInfo.clientId);
                     if (it != clientMap.end()) {
-                        it->second->stop();  // Ensure thread is stopped
+                        it->second->stop();  // no new tasks, a running task still holds a reference
                         clientMap.erase(it);  // Erase the object from the map
+                        waterfallTopics.erase(clientInfo.clientId);   // uWS removes the subscriptions of a closed socket
+                        numClients = clientMap.size();
                     }
                     else {
                         std::cout << "Client ignored, max_user reached" << std::endl;
@@ -97,39 +119,182 @@ void ClientManager::processMessages() {
             }
         } 
 
-        // Send FFT data (bigFFTqueue) to all Web-clients via the WebSocket
-        std::array<float, 1025> fftData;
-        if (bigFFTqueue.pop(fftData)) {
-            WebSocketServer& WSSinstance = WebSocketServer::getInstance();
-            WSSinstance.sendDataToClient(fftData,-1);
-        }
+        for (int vband = 0; vband < MAX_VBANDS; vband++) {
+            // Send FFT data (bigFFTqueue) to the Web-clients of this virtual band via the WebSocket
+            BigFFTData fftData;
+            if (bigFFTqueue[vband].pop(fftData)) {
+                publishWaterfall(vband, fftData.bins);
+                if (fftData.carriers) publishCarriers(vband, *fftData.carriers);
+
+                // small waterfall and own spectrum windows from the same spectrum, different for every client
+                if (fftData.fullSpectrum || fftData.pyramid) {
+                    for (auto& clientPair : clientMap) {
+                        if (clientPair.second->getVBand() != vband) continue;
+                        if (fftData.fullSpectrum) {
+                            clientPair.second->sliceNarrowSpectrum(*fftData.fullSpectrum);
+                        }
+                        if (fftData.pyramid && clientPair.second->hasSpectrumWindow()) {
+                            clientPair.second->sendSpectrumWindow(*fftData.pyramid);
+                        }
+                    }
+                }
+            }
+
+            // run the Channelizer FFT of this virtual band over the raw samples
+            // and send the spectra (messageId == 3) to its clientObjects
+            SampleBlockPtr sampleBlock;
+            if (rawSamplesQueue[vband].pop(sampleBlock)) {
+                Channelizer& channelizer = Channelizer::getInstance(vband);
+                channelizerFrames.clear();
+                channelizer.processSamples(sampleBlock->sdata, sampleBlock->numSamples, channelizerFrames);
+
+                for (auto& frame : channelizerFrames) {
+                    // Create ClientInfo for the spectrum, all clients of the band share the same frame
+                    ClientInfo rawClientInfo;
+                    rawClientInfo.messageId = 3;
+                    rawClientInfo.samples = frame;
+
+                    for (auto& clientPair : clientMap) {
+                        ClientObject* clientObject = clientPair.second.get();
+                        if (clientObject->getVBand() != vband) continue;
+                        rawClientInfo.clientId = clientPair.first;
 
-        // send raw sample data (messageId == 3) to all clientObjects
-        SampleData sampleData;
-        if (rawSamplesQueue.pop(sampleData)) {
-            // Create ClientInfo for raw data
-            ClientInfo rawClientInfo;
-            rawClientInfo.messageId = 3;
-            rawClientInfo.sdata = sampleData.sdata;  // Copy raw data
-
-            // Send rawClientInfo to all active clientObjects
-            for (auto& clientPair : clientMap) {
-                ClientObject* clientObject = clientPair.second.get();
-                rawClientInfo.clientId = clientPair.first;
-                rawClientInfo.clientIP = clientObject->getClientIP();
-
-                if (!clientObject->enqueueInfoForCLient(rawClientInfo)) {
-                    std::cerr << "Failed to enqueue raw data for client " << rawClientInfo.clientId << std::endl;
+                        if (!clientObject->enqueueInfoForCLient(rawClientInfo)) {
+                            std::cerr << "Failed to enqueue raw data for client " << rawClientInfo.clientId << std::endl;
+                        }
+                    }
                 }
+                channelizerFrames.clear();
             }
         }
 
+        // tell the IngestProcessor which virtual bands are needed
+        updateSubscribers();
+
         // check user and password
         checkUserPW();
 
-        // Sleep for a short duration to avoid busy-waiting
-        std::this_thread::sleep_for(std::chrono::microseconds(100));
+        // configuration updates of the clients
+        scheduleClients();
+
+        // sleep until new data arrives, but update the clients every 100 ms
+        notifier.wait([this] { return hasInput(); }, 100);
+    }
+}
+
+void ClientManager::scheduleClients()
+{
+    static auto lastTime = std::chrono::steady_clock::now();
+    auto now = std::chrono::steady_clock::now();
+    if (now - lastTime < std::chrono::milliseconds(100)) return;
+    lastTime = now;
+
+    numClients = clientMap.size();
+    for (auto& clientPair : clientMap) {
+        clientPair.second->schedule();
+    }
+}
+
+void ClientManager::updateSubscribers()
+{
+    WebSocketServer& WSSinstance = WebSocketServer::getInstance();
+    int num[MAX_VBANDS] = {};
+    int windows[MAX_VBANDS] = {};
+    int carrierClients[MAX_VBANDS] = {};
+    for (int vband = 0; vband < MAX_VBANDS; vband++) {
+        floatSubscribers[vband] = 0;
+        compressedSubscribers[vband] = 0;
+    }
+
+    for (auto& clientPair : clientMap) {
+        int vband = clientPair.second->getVBand();
+        bool compressed = clientPair.second->getWaterfallFormat() != 0;
+        num[vband]++;
+
+        // move the client to the waterfall topic of its band and format,
+        // a client with its own window leaves the topics
+        int topic = -1;
+        if (clientPair.second->hasSpectrumWindow()) {
+            windows[vband]++;
+        } else {
+            (compressed ? compressedSubscribers : floatSubscribers)[vband]++;
+            topic = waterfallTopic(vband, compressed);
+        }
+        WaterfallSubscription& subscription = waterfallTopics[clientPair.first];
+        if (subscription.topic != topic) {
+            WSSinstance.changeSubscription({clientPair.first, subscription.topic, topic});
+            subscription.topic = topic;
+            // the new subscriber can start with the next line
+            if (compressed && topic >= 0) wideEncoders[vband].reset();
+        }
+        // the carrier list only for the browsers which asked for it (message 9)
+        int carriers = -1;
+        if (clientPair.second->wantsCarriers()) {
+            carriers = carrierTopic(vband);
+            carrierClients[vband]++;
+        }
+        if (subscription.carrierTopic != carriers) {
+            WSSinstance.changeSubscription({clientPair.first, subscription.carrierTopic, carriers});
+            subscription.carrierTopic = carriers;
+        }
+
+        // a new browser gets the last lines of its band at once instead of an empty waterfall
+        // (encoded on the DSPThreadPool, about 300 lines), only if it asked for them (message 10)
+        if (compressed && clientPair.second->wantsHistory() && !subscription.historySent) {
+            DSPThreadPool::getInstance().submit([client = clientPair.second, vband]() {
+                client->sendWaterfallHistory(FFTProcessor::getInstance(vband).getHistory().getBurst());
+            });
+            subscription.historySent = true;
+        }
+    }
+
+    VirtualBands& vbands = VirtualBands::getInstance();
+    for (int vband = 0; vband < MAX_VBANDS; vband++) {
+        vbands.setSubscribers(vband, num[vband]);
+        carrierSubscribers[vband] = carrierClients[vband];
+        FFTProcessor::getInstance(vband).setPyramidWanted(windows[vband] > 0);
+    }
+}
+
+void ClientManager::publishWaterfall(int vband, const std::array<float, 1025>& bins)
+{
+    WebSocketServer& WSSinstance = WebSocketServer::getInstance();
+
+    if (floatSubscribers[vband] > 0) {
+        ClientTXData txdata;
+        txdata.clientId = -1;
+        txdata.topic = waterfallTopic(vband, false);
+        txdata.data = bins;
+        WSSinstance.broadcast(txdata);
+    }
+
+    if (compressedSubscribers[vband] > 0) {
+        ClientTXData txdata;
+        txdata.clientId = -1;
+        txdata.topic = waterfallTopic(vband, true);
+        wideEncoders[vband].encode(bins, txdata);
+        WSSinstance.broadcast(txdata);
+    }
+}
+
+// legacy layout: ID 10, number of carriers, then frequency, bandwidth and SNR of each carrier
+void ClientManager::publishCarriers(int vband, const std::vector<Carrier>& carriers)
+{
+    if (carrierSubscribers[vband] == 0) return;
+
+    ClientTXData txdata;
+    txdata.clientId = -1;
+    txdata.topic = carrierTopic(vband);
+    txdata.data[0] = 10.0f;
+    unsigned int num = std::min<size_t>(carriers.size(), (txdata.data.size() - 2) / 3);
+    txdata.data[1] = static_cast<float>(num);
+    for (unsigned int i = 0; i < num; i++) {
+        txdata.data[2 + 3 * i] = carriers[i].frequency;
+        txdata.data[3 + 3 * i] = carriers[i].bandwidth;
+        txdata.data[4 + 3 * i] = carriers[i].snr;
     }
+    txdata.length = (2 + 3 * num) * sizeof(float);
+    WebSocketServer::getInstance().broadcast(txdata);
 }
 
 void ClientManager::checkUserPW()
@@ -160,9 +325,12 @@ void ClientManager::checkUserPW()
         // Add a 0 terminator after the string
         data[length + 1] = 0.0f;
 
-        // send to all clients
+        // send to all clients, published once to the TOPIC_ALL subscribers
+        ClientTXData txdata;
+        txdata.clientId = -1;
+        txdata.data = data;
         WebSocketServer& WSSinstance = WebSocketServer::getInstance();
-        WSSinstance.sendDataToClient(data);
+        WSSinstance.broadcast(txdata);
 
         lastTime = now;
         //std::cout << "all users: " << users << std::endl;
@@ -5,8 +5,13 @@
 #include <unordered_map>
 #include <thread>
 #include <atomic>
+#include <memory>
 #include "global.h"
 #include "ClientObject.h"
+#include "VirtualBands.h"
+#include "EventNotifier.h"
+#include "SpectrumPyramid.h"
+#include "CarrierDetector.h"
 
 class ClientManager {
 public:
@@ -22,11 +27,16 @@ public:
     // Function to allow WebSocketServer to push data into the queue
     bool enqueueClientInfo(const ClientInfo& clientInfo);
 
-    // Function to push SampleData into rawSamplesQueue
-    bool enqueueRawSamples(const SampleData& sampleData);
+    // Function to push a block of raw samples of a virtual band into rawSamplesQueue
+    bool enqueueRawSamples(int vband, const SampleBlockPtr& sampleBlock);
 
-    // Function to push big FFT data into the queue
-    bool enqueueFFTData(const std::array<float, 1025>& fftData);
+    // Function to push big FFT data of a virtual band into the queue
+    // fullSpectrum (optional): averaged power of all FFT bins, for the small waterfalls
+    // pyramid (optional): the spectrum at all resolutions, for the clients with their own window
+    // carriers (optional): active signals of the band, published to its clients
+    bool enqueueFFTData(int vband, const std::array<float, 1025>& fftData,
+                        std::shared_ptr<const std::vector<float>> fullSpectrum = nullptr,
+                        SpectrumPyramidPtr pyramid = nullptr, CarrierList carriers = nullptr);
 
     // get number of active clients
     int getNumberOfLoggedInClients();
@@ -45,14 +55,33 @@ private:
     // handles user and password of the clients
     void checkUserPW();
 
+    // count the clients of every virtual band
+    // and move the clients to the waterfall and carrier topics of their virtual band and format
+    void updateSubscribers();
+
+    // encode a wideband waterfall line once and publish it to the clients of the virtual band
+    void publishWaterfall(int vband, const std::array<float, 1025>& bins);
+
+    // publish the carrier list (ID 10) to all clients of the virtual band
+    void publishCarriers(int vband, const std::vector<Carrier>& carriers);
+
     // The SPSC queue for client events
     boost::lockfree::spsc_queue<ClientInfo, boost::lockfree::capacity<100>> clientQueue;
 
-    // Queue for raw sample data
-    boost::lockfree::spsc_queue<SampleData, boost::lockfree::capacity<1024>> rawSamplesQueue;
+    // Queues for raw sample data (handles to the blocks of the IngestProcessor), one per virtual band
+    std::array<boost::lockfree::spsc_queue<SampleBlockPtr, boost::lockfree::capacity<1024>>, MAX_VBANDS> rawSamplesQueue;
 
-    // Queue for FFT bins (full scale FFT)
-    boost::lockfree::spsc_queue<std::array<float, 1025>, boost::lockfree::capacity<100>> bigFFTqueue;
+    // spectra of the Channelizer, reused to avoid allocations
+    std::vector<SampleBlockPtr> channelizerFrames;
+
+    // Queues for FFT bins (full scale FFT), one per virtual band
+    struct BigFFTData {
+        std::array<float, 1025> bins;
+        std::shared_ptr<const std::vector<float>> fullSpectrum;
+        SpectrumPyramidPtr pyramid;
+        CarrierList carriers;
+    };
+    std::array<boost::lockfree::spsc_queue<BigFFTData, boost::lockfree::capacity<100>>, MAX_VBANDS> bigFFTqueue;
 
     // Queue for FFT bins (narrowband FFT)
     boost::lockfree::spsc_queue<std::array<float, 1025>, boost::lockfree::capacity<100>> smallFFTqueue;
@@ -61,8 +90,36 @@ private:
     // queue for about 2 seconds (8kHz sample rate and 1024 sample packets)
     boost::lockfree::spsc_queue<std::array<float, 1025>, boost::lockfree::capacity<20>> audioQueue;
 
+    // wakes up the processing thread if data was pushed into one of the queues
+    EventNotifier notifier;
+
+    // true if one of the input queues has data
+    bool hasInput();
+
     // Map to store the active ClientObjects by clientId
-    std::unordered_map<int, std::unique_ptr<ClientObject>> clientMap;
+    // shared_ptr: a task on the DSPThreadPool keeps its ClientObject alive after the logout
+    std::unordered_map<int, std::shared_ptr<ClientObject>> clientMap;
+    std::atomic<int> numClients{0};     // clientMap.size(), read by the client tasks
+
+    // wideband waterfall topic of each client (see WebSocketServer.h), -1: not subscribed yet
+    // and if it got the waterfall history already (once, with the first compressed topic)
+    // carrierTopic: carrier list of the virtual band, independent of the waterfall format and window
+    struct WaterfallSubscription {
+        int topic = -1;
+        int carrierTopic = -1;
+        bool historySent = false;
+    };
+    std::unordered_map<int, WaterfallSubscription> waterfallTopics;
+    // subscribers of the float and the compressed waterfall topic of each virtual band
+    // the clients with their own spectrum window get their lines from the pyramid instead
+    int floatSubscribers[MAX_VBANDS] = {};
+    int compressedSubscribers[MAX_VBANDS] = {};
+    int carrierSubscribers[MAX_VBANDS] = {};    // clients of the virtual band which want the carrier list
+    // one encoder per virtual band, the clients decode from the next keyframe after subscribing
+    std::vector<WaterfallEncoder> wideEncoders = std::vector<WaterfallEncoder>(MAX_VBANDS, WaterfallEncoder(0));
+
+    // the clients update the browser configuration in their task, started every 100 ms
+    void scheduleClients();
 };
 
 #endif // CLIENTMANAGER_H
@@ -4,32 +4,44 @@
 #include "WebSocketServer.h"
 #include "ClientManager.h"
 #include "SDRHardware.h"
+#include "VirtualBands.h"
+#include "DSPThreadPool.h"
 #include <chrono>
+#include <algorithm>
+#include <cmath>
 
 using namespace std::chrono;
 
-// Constructor: Starts the thread for processing
-ClientObject::ClientObject(int clientId, const std::string& clientIP)
-    : clientId(clientId), keepRunning(true), clientIP(clientIP), clientObjectInputQueue() {
-    clientThread = std::thread(&ClientObject::processClient, this);
+// Constructor, the processing runs as tasks on the DSPThreadPool
+ClientObject::ClientObject(int clientId, const std::string& clientIP, std::shared_ptr<ClientTXQueue> txQueue)
+    : clientId(clientId), keepRunning(true), clientIP(clientIP), clientObjectInputQueue(), txQueue(std::move(txQueue)) {
+    if (!narrowFromWideband) {
+        narrowFFT = std::make_unique<NarrowFFTProcessor>();
+    }
+    start_time = std::chrono::steady_clock::now();
 }
 
-// Destructor: Ensures the thread is stopped and joined
+// Destructor, runs after the last task of this client has finished
 ClientObject::~ClientObject() {
-    stop();
-    if (clientThread.joinable()) {
-        clientThread.join();
-    }
 }
 
-// Function to stop the thread
+// Function to stop the processing, no more tasks are started
 void ClientObject::stop() {
     keepRunning = false;
 }
 
 // Function to enqueue client info (used by ClientManager)
 bool ClientObject::enqueueInfoForCLient(const ClientInfo& clientInfo) {
-    return clientObjectInputQueue.push(clientInfo);  // Push data into the queue
+    bool ret = clientObjectInputQueue.push(clientInfo);  // Push data into the queue
+    schedule();
+    return ret;
+}
+
+// virtual band of the client, falls back to the first band if the selected
+// band is not in the current band group (e.g. before a retune took place)
+int ClientObject::getVBand() const {
+    int vband = VirtualBands::getInstance().getVBand(selectedBand);
+    return vband < 0 ? 0 : vband;
 }
 
 // Get the client's IP address
@@ -37,94 +49,138 @@ std::string ClientObject::getClientIP() const {
     return clientIP;
 }
 
-// Thread function to process client messages
+// schedules processClient() on the DSP thread pool
+// there is never more than one task per client, so the client state needs no locking
+void ClientObject::schedule() {
+    if (scheduled.exchange(true)) return;   // the queued or running task will see the new data
+
+    DSPThreadPool::getInstance().submit([self = shared_from_this()] {
+        self->processClient();
+    });
+}
+
+// DSP task: processes the queued messages, then updates the browser configuration
 void ClientObject::processClient() {
-    float freq=0.0f,shift=0.0f,mode=0.0f,startQRG=0.0f,endQRG=0.0f,unum=-1;
-    auto start_time = std::chrono::steady_clock::now();
-    bool executed = false;
-
-    while (keepRunning && keeprunning) {
-        ClientInfo clientInfo;
-        // Process any incoming messages in the queue
-        if (clientObjectInputQueue.pop(clientInfo)) {
-            // Message ID:
-            // 0 ... waterfall index 0...1024 in the big waterfall
-            // 1 ... band selection
-            // 2 ... mode selection
-            // 3 ... raw samples 480 kS/s
-            switch (clientInfo.messageId) {
-                case 2: { // message from Browser
-                        int BrowserMessageID = static_cast<int>(std::round(clientInfo.message[0]));
-                        // Message ID:
-                        // 0 ... waterfall tuning frequency from the user
-                        // 1 ... band selection
-                        // 2 ... mode selection
-                        // 3 ... ssb filter
-                        // 4 ... user login data
-                        switch (BrowserMessageID) {
-                            case 0: setFrequency(clientInfo);
-                                    break;
-                            case 1: setBand(clientInfo);
-                                    break;
-                            case 2: setMode(clientInfo);
-                                    break;
-                            case 3: setFilter(clientInfo);
-                                    break;
-                            case 4: userPW(clientInfo);
-                                    break;
-                        }
-                        break;
+    ClientInfo clientInfo;
+    while (keepRunning && keeprunning && clientObjectInputQueue.pop(clientInfo)) {
+        handleMessage(clientInfo);
+    }
+
+    if (keepRunning) {
+        updateBandCenter();
+        sendConfiguration();
+    }
+
+    scheduled = false;
+    // a message which was pushed after the last pop did not schedule a new task
+    if (keepRunning && clientObjectInputQueue.read_available() > 0) {
+        schedule();
+    }
+}
+
+void ClientObject::handleMessage(ClientInfo& clientInfo) {
+    // Message ID:
+    // 0 ... waterfall index 0...1024 in the big waterfall
+    // 1 ... band selection
+    // 2 ... mode selection
+    // 3 ... raw samples 480 kS/s
+    switch (clientInfo.messageId) {
+        case 2: { // message from Browser
+                int BrowserMessageID = static_cast<int>(std::round(clientInfo.message[0]));
+                // Message ID:
+                // 0 ... waterfall tuning frequency from the user
+                // 1 ... band selection
+                // 2 ... mode selection
+                // 3 ... ssb filter
+                // 4 ... user login data
+                // 5 ... audio frame size
+                // 6 ... audio codec
+                // 7 ... waterfall format
+                // 8 ... spectrum window (start, span, width)
+                // 9 ... carrier list on/off
+                // 10 .. waterfall history on/off
+                switch (BrowserMessageID) {
+                    case 0: setFrequency(clientInfo);
+                            break;
+                    case 1: setBand(clientInfo);
+                            break;
+                    case 2: setMode(clientInfo);
+                            break;
+                    case 3: setFilter(clientInfo);
+                            break;
+                    case 4: userPW(clientInfo);
+                            break;
+                    case 5: setAudioFrameSize(clientInfo);
+                            break;
+                    case 6: setAudioCodec(clientInfo);
+                            break;
+                    case 7: setWaterfallFormat(clientInfo);
+                            break;
+                    case 8: setSpectrumWindow(clientInfo);
+                            break;
+                    case 9: setCarrierList(clientInfo);
+                            break;
+                    case 10: setWaterfallHistory(clientInfo);
+                            break;
                 }
-                case 3: decodeSamples(clientInfo);
-                        break;
-            }
-        } else {
-            // send configuration data to the client browser
-            SDRHardware& hardware = SDRHardware::getInstance();
-
-            ClientTXData configdata;
-            configdata.clientId = clientId;
-            configdata.data[0] = 2.0f;  // ID for configuration data
-            configdata.data[1] = hardware.getTuningFrequency();
-            configdata.data[2] = tuner.getFrequencyShift();
-            configdata.data[3] = signaldecoder.getUsbLsb();
-            configdata.data[4] = StartQRG;
-            configdata.data[5] = EndQRG;
-            configdata.data[6] = ClientManager::getInstance().getNumberOfLoggedInClients();
-            configdata.authenticated = checkPW();
-
-            bool hasChanged = false;
-            if(freq != configdata.data[1]) hasChanged = true;
-            if(shift != configdata.data[2]) hasChanged = true;
-            if(mode != configdata.data[3]) hasChanged = true;
-            if(startQRG != configdata.data[4]) hasChanged = true;
-            if(endQRG != configdata.data[5]) hasChanged = true;
-            if(unum != configdata.data[6]) hasChanged = true;
-
-            // Check if 2 seconds have elapsed after start and delayedFunction() has not been executed yet
-            auto current_time = std::chrono::steady_clock::now();
-            auto elapsed = std::chrono::duration_cast<std::chrono::seconds>(current_time - start_time).count();
-
-            if (elapsed >= 1 && !executed) {
-                hasChanged = true;
-                executed = true; // Ensure delayedFunction() is called only once
-            }
-
-            if (hasChanged) {
-                WebSocketServer& WSSinstance = WebSocketServer::getInstance();
-                WSSinstance.sendDataToClient(configdata);
-
-                freq = configdata.data[1];
-                shift = configdata.data[2];
-                mode = configdata.data[3];
-                startQRG = configdata.data[4];
-                endQRG = configdata.data[5];
-                unum = configdata.data[6];
-            }
-
-            // Sleep for a short duration to avoid busy-waiting
-            std::this_thread::sleep_for(std::chrono::microseconds(100));
+                break;
         }
+        case 3: decodeSamples(clientInfo);
+                break;
+    }
+}
+
+// send configuration data to the client browser if something has changed
+void ClientObject::sendConfiguration() {
+    VirtualBands& vbands = VirtualBands::getInstance();
+    int vband = getVBand();
+
+    ClientTXData configdata;
+    configdata.clientId = clientId;
+    configdata.data[0] = 2.0f;  // ID for configuration data
+    configdata.data[1] = vbands.getCenterFrequency(vband);  // center of the 480 kHz segment
+    configdata.data[2] = tuner.getFrequencyShift();
+    configdata.data[3] = signaldecoder.getUsbLsb();
+    configdata.data[4] = vbands.getStartQRG(vband);
+    configdata.data[5] = vbands.getEndQRG(vband);
+    configdata.data[6] = ClientManager::getInstance().getNumberOfLoggedInClients();
+    // bands of the current band group, these can be selected without retuning
+    int bandsum = 0;
+    for (int i = 0; i < MAX_VBANDS; i++) {
+        configdata.data[7 + i] = vbands.getBand(i);
+        bandsum = bandsum * 1000 + vbands.getBand(i);
+    }
+    configdata.authenticated = checkPW();
+
+    bool hasChanged = false;
+    if(sentConfig.freq != configdata.data[1]) hasChanged = true;
+    if(sentConfig.shift != configdata.data[2]) hasChanged = true;
+    if(sentConfig.mode != configdata.data[3]) hasChanged = true;
+    if(sentConfig.startQRG != configdata.data[4]) hasChanged = true;
+    if(sentConfig.endQRG != configdata.data[5]) hasChanged = true;
+    if(sentConfig.unum != configdata.data[6]) hasChanged = true;
+    if(sentConfig.groupBands != bandsum) hasChanged = true;
+
+    // send it once more 1 s after the start, when the browser is ready for it
+    auto current_time = std::chrono::steady_clock::now();
+    auto elapsed = std::chrono::duration_cast<std::chrono::seconds>(current_time - start_time).count();
+
+    if (elapsed >= 1 && !sentConfig.executed) {
+        hasChanged = true;
+        sentConfig.executed = true;
+    }
+
+    if (hasChanged) {
+        txQueue->push(configdata, ClientTXQueue::AUDIO);
+        WebSocketServer::getInstance().wakeup();
+
+        sentConfig.freq = configdata.data[1];
+        sentConfig.shift = configdata.data[2];
+        sentConfig.mode = configdata.data[3];
+        sentConfig.startQRG = configdata.data[4];
+        sentConfig.endQRG = configdata.data[5];
+        sentConfig.unum = configdata.data[6];
+        sentConfig.groupBands = bandsum;
     }
 }
 
@@ -132,13 +188,30 @@ void ClientObject::setFrequency(ClientInfo clientInfo)
 {
     float findex = clientInfo.message[1];
     tuner.setRXFrequencyOffset(findex);
+    narrowShift = tuner.getFrequencyShift();
+}
+
+// the browser tunes relative to the band start, the segment is centered on the band,
+// so the shift changes with the width of the band (after a band change or a retune)
+void ClientObject::updateBandCenter()
+{
+    VirtualBands& vbands = VirtualBands::getInstance();
+    int vband = getVBand();
+    tuner.setBandCenterOffset(static_cast<float>(vbands.getCenterFrequency(vband) - vbands.getStartQRG(vband)));
+    narrowShift = tuner.getFrequencyShift();
 }
 
 void ClientObject::setBand(ClientInfo clientInfo)
 {
-    float fband = static_cast<int>(std::round(clientInfo.message[1]));
-    SDRHardware& hardware = SDRHardware::getInstance();
-    hardware.setBand(fband);
+    int band = static_cast<int>(std::round(clientInfo.message[1]));
+    selectedBand = band;
+
+    // a band of the current group is just another virtual band,
+    // otherwise the hardware must be retuned (only allowed for a single user)
+    if (VirtualBands::getInstance().getVBand(band) < 0) {
+        SDRHardware& hardware = SDRHardware::getInstance();
+        hardware.setBand(band);
+    }
 }
 
 void ClientObject::setMode(ClientInfo clientInfo)
@@ -153,6 +226,21 @@ void ClientObject::setFilter(ClientInfo clientInfo)
     signaldecoder.setFilter(ffilter);
 }
 
+void ClientObject::setAudioFrameSize(ClientInfo clientInfo)
+{
+    if (clientInfo.message.size() < 2) return;
+    signaldecoder.setAudioFrameSize(clientInfo.message[1]);
+}
+
+void ClientObject::setAudioCodec(ClientInfo clientInfo)
+{
+    if (clientInfo.message.size() < 2) return;
+    int codec = static_cast<int>(std::round(clientInfo.message[1]));
+    if (!audioEncoder.setCodec(codec)) {
+        printf("invalid audio codec: %d\n", codec);
+    }
+}
+
 void ClientObject::userPW(ClientInfo clientInfo) {
     // Convert the float vector to a string
     std::string combinedText;
@@ -191,29 +279,156 @@ void ClientObject::decodeSamples(ClientInfo clientInfo)
     ClientInfo samples_baseband_48 = tuner.doTuning(clientInfo);
 
     // send the samples to the SignalDecoder for demodulation
-    std::vector<float> audiosamples = signaldecoder.demodulate(samples_baseband_48);
-    if (!audiosamples.empty()) {
-        if (audiosamples.size() == 1025) {
-            // the 1024 audio samples and the ID are in the float vector audiosamples.message
-            ClientTXData txdata;
-            std::copy(audiosamples.begin(), audiosamples.end(), txdata.data.begin());
-            txdata.clientId = clientId;
-            txdata.authenticated = checkPW();
-
-            WebSocketServer& WSSinstance = WebSocketServer::getInstance();
-            WSSinstance.sendDataToClient(txdata);
-        }
-        else {
-            std::cerr << "Error: audiosamples has an incorrect size of " << audiosamples.size() << " elements.\n";
-        }
+    signaldecoder.demodulate(samples_baseband_48);
+
+    // send the complete audio frames (size and format selected by the browser)
+    float frame[AudioFramer::MAX_FRAME_SIZE];
+    unsigned int frameSize;
+    bool sent = false;
+    while ((frameSize = signaldecoder.readAudioFrame(frame)) > 0) {
+        ClientTXData txdata;
+        txdata.clientId = clientId;
+        audioEncoder.encode(frame, frameSize, txdata);
+        txdata.authenticated = checkPW();
+
+        txQueue->push(txdata, ClientTXQueue::AUDIO);
+        sent = true;
     }
+    // one wakeup for all frames of this block
+    if (sent) WebSocketServer::getInstance().wakeup();
 
     // send the samples to the narrow band FFT
     samples_baseband_48.clientId = clientId;
     samples_baseband_48.messageId = 3;
     if(!checkPW()) {
         // not authenticated, clear data
-        samples_baseband_48.sdata.clear();
+        samples_baseband_48.samples.reset();
+    }
+    std::array<float, 1025> bins1024;
+    if (narrowFFT && narrowFFT->processSamples(samples_baseband_48, bins1024)) {
+        sendWaterfall(bins1024);
+    }
+}
+
+// called by the ClientManager with the spectrum of the virtual band of this client
+void ClientObject::sliceNarrowSpectrum(const std::vector<float>& fullSpectrum)
+{
+    if (!checkPW()) return;
+
+    std::array<float, 1025> bins1024;
+    narrowSlicer.slice(fullSpectrum, narrowShift, bins1024);
+    sendWaterfall(bins1024);
+}
+
+// narrow waterfall line (ID 1) in the format selected by the browser
+void ClientObject::sendWaterfall(const std::array<float, 1025>& bins)
+{
+    ClientTXData txdata;
+    txdata.clientId = clientId;
+    if (waterfallFormat == 0) {
+        txdata.data = bins;
+    } else {
+        narrowEncoder.encode(bins, txdata);
+    }
+    txQueue->push(txdata, ClientTXQueue::WATERFALL);
+    WebSocketServer::getInstance().wakeup();
+}
+
+void ClientObject::sendWaterfallHistory(WaterfallBurst burst)
+{
+    if (!burst || burst->empty()) return;
+    txQueue->setBurst(std::move(burst));
+    WebSocketServer::getInstance().wakeup();
+}
+
+// wideband line of the own window, same layout as the shared lines (ID 0 or ID 9 with waterfall 0)
+void ClientObject::sendSpectrumWindow(const SpectrumPyramid& pyramid)
+{
+    VirtualBands& vbands = VirtualBands::getInstance();
+    int vband = getVBand();
+    float bandwidth = static_cast<float>(vbands.getEndQRG(vband) - vbands.getStartQRG(vband));
+
+    SpectrumWindow selected;
+    {
+        std::lock_guard<std::mutex> lock(windowMutex);
+        selected = window;
+    }
+
+    float span = std::min(selected.span, bandwidth);
+    float start = std::min(std::max(selected.start, 0.0f), bandwidth - span);
+    bool compressed = waterfallFormat != 0;
+    // the float format has room for 1024 bins only
+    unsigned int width = std::min(selected.width, compressed ? WATERFALL_MAX_BINS : 1024u);
+
+    float line[WATERFALL_MAX_BINS];
+    pyramid.extract(start, span, width, line);
+
+    ClientTXData txdata;
+    txdata.clientId = clientId;
+    if (compressed) {
+        if (windowChanged.exchange(false)) windowEncoder.reset();
+        windowEncoder.encode(line, width, txdata);
+    } else {
+        txdata.data[0] = 0.0f;
+        std::copy(line, line + width, txdata.data.begin() + 1);
+        txdata.length = (width + 1) * sizeof(float);
+    }
+    txQueue->push(txdata, ClientTXQueue::WINDOW);
+    WebSocketServer::getInstance().wakeup();
+}
+
+// message 8: start and span in Hz above the band start, width in bins (power of two, 256 ... WATERFALL_MAX_BINS)
+void ClientObject::setSpectrumWindow(ClientInfo clientInfo)
+{
+    if (clientInfo.message.size() < 3) return;
+    SpectrumWindow selected;
+    selected.start = clientInfo.message[1];
+    selected.span = clientInfo.message[2];
+    if (!std::isfinite(selected.start) || !std::isfinite(selected.span) || selected.span < 0.0f) {
+        printf("invalid spectrum window: %f %f\n", selected.start, selected.span);
+        return;
+    }
+    if (clientInfo.message.size() >= 4) {
+        float width = clientInfo.message[3];
+        if (!std::isfinite(width) || width < 256.0f || width > WATERFALL_MAX_BINS) {
+            printf("invalid spectrum window width: %f\n", width);
+            return;
+        }
+        selected.width = static_cast<unsigned int>(std::round(width));
+        if ((selected.width & (selected.width - 1)) != 0) {
+            printf("invalid spectrum window width: %u\n", selected.width);
+            return;
+        }
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(windowMutex);
+        window = selected;
+    }
+    windowActive = selected.span > 0.0f;
+    windowChanged = true;
+}
+
+void ClientObject::setCarrierList(ClientInfo clientInfo)
+{
+    if (clientInfo.message.size() < 2) return;
+    carriersWanted = clientInfo.message[1] != 0.0f;
+}
+
+void ClientObject::setWaterfallHistory(ClientInfo clientInfo)
+{
+    if (clientInfo.message.size() < 2) return;
+    historyWanted = clientInfo.message[1] != 0.0f;
+}
+
+void ClientObject::setWaterfallFormat(ClientInfo clientInfo)
+{
+    if (clientInfo.message.size() < 2) return;
+    int format = static_cast<int>(std::round(clientInfo.message[1]));
+    if (format != 0 && format != WATERFALL_CODEC_VERSION) {
+        printf("unsupported waterfall format: %d\n", format);
+        return;
     }
-    narrowFFT.pushSampleData(samples_baseband_48);
+    waterfallFormat = format;
+    windowChanged = true;
 }
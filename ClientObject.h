@@ -1,29 +1,39 @@
 #ifndef CLIENTOBJECT_H
 #define CLIENTOBJECT_H
 
-#include <thread>
+#include <chrono>
 #include <atomic>
+#include <memory>
+#include <mutex>
 #include <iostream>
 #include <boost/lockfree/spsc_queue.hpp>
 #include "global.h"
 #include "Tuner.h"
 #include "SignalDecoder.h"
 #include "NarrowFFT.h"
+#include "AudioCodec.h"
+#include "WaterfallCodec.h"
+#include "SpectrumPyramid.h"
+#include "ClientTXQueue.h"
 
-class ClientObject {
+// owned by the ClientManager with a shared_ptr, the running task keeps the object alive
+class ClientObject : public std::enable_shared_from_this<ClientObject> {
 public:
-    // Constructor that starts the client thread
-    ClientObject(int clientId, const std::string& clientIP);
+    // Constructor, no thread: the processing runs on the DSPThreadPool
+    // txQueue: outbound frames, emptied by the WebSocketServer
+    ClientObject(int clientId, const std::string& clientIP, std::shared_ptr<ClientTXQueue> txQueue);
     
-    // Destructor to clean up the thread
     ~ClientObject();
 
     // Function to stop the client's processing
     void stop();
 
-    // Function to enqueue client info (used by ClientManager)
+    // Function to enqueue client info (used by ClientManager), schedules the processing
     bool enqueueInfoForCLient(const ClientInfo& clientInfo);
 
+    // run the processing task (also called periodically by the ClientManager for the configuration)
+    void schedule();
+
     // Get the client's IP address
     std::string getClientIP() const;
 
@@ -33,20 +43,67 @@ public:
     std::string username = "";
     std::string password = "";
 
-private:
-    // The thread that does the processing for the client
-    std::thread clientThread;
+    // virtual band which is used by this client
+    int getVBand() const;
+
+    // small waterfall from the full resolution spectrum of the FFTProcessor (narrowFromWideband mode)
+    void sliceNarrowSpectrum(const std::vector<float>& fullSpectrum);
+
+    // send a narrow waterfall line (ID 1 followed by 1024 dB values) in the format selected by the browser
+    // the wideband lines are published once per virtual band by the ClientManager
+    void sendWaterfall(const std::array<float, 1025>& bins);
+
+    // waterfall format selected by the browser: 0 = float, else WATERFALL_CODEC_VERSION
+    int getWaterfallFormat() const { return waterfallFormat; }
+
+    // the browser asked for the carrier list (ID 10) of its band
+    bool wantsCarriers() const { return carriersWanted; }
+
+    // the browser asked for the last lines of the wideband waterfall (compressed format only)
+    bool wantsHistory() const { return historyWanted; }
+
+    // send the last lines of the wideband waterfall after everything else (compressed format only)
+    void sendWaterfallHistory(WaterfallBurst burst);
 
-    // Internal function that runs in the thread
+    // own section of the wideband spectrum (zoom) instead of the shared waterfall topic
+    bool hasSpectrumWindow() const { return windowActive; }
+
+    // send a wideband line (ID 0) of the own window, cut out of the pyramid of the virtual band (ClientManager thread)
+    void sendSpectrumWindow(const SpectrumPyramid& pyramid);
+
+private:
+    // task on the DSPThreadPool, never runs twice at the same time
     void processClient();
+    std::atomic<bool> scheduled{false};
+
+    void handleMessage(ClientInfo& clientInfo);
+    void sendConfiguration();
+
+    // configuration which was sent to the browser
+    struct {
+        float freq = 0.0f, shift = 0.0f, mode = 0.0f, startQRG = 0.0f, endQRG = 0.0f, unum = -1;
+        int groupBands = 0;
+        bool executed = false;
+    } sentConfig;
+    std::chrono::steady_clock::time_point start_time;
 
     void setFrequency(ClientInfo clientInfo);
+    void updateBandCenter();
     void setBand(ClientInfo clientInfo);
     void setMode(ClientInfo clientInfo);
     void setFilter(ClientInfo clientInfo);
+    void setAudioFrameSize(ClientInfo clientInfo);
+    void setAudioCodec(ClientInfo clientInfo);
+    void setWaterfallFormat(ClientInfo clientInfo);
+    void setSpectrumWindow(ClientInfo clientInfo);
+    void setCarrierList(ClientInfo clientInfo);
+    void setWaterfallHistory(ClientInfo clientInfo);
     void decodeSamples(ClientInfo clientInfo);
     void userPW(ClientInfo clientInfo);
 
+    // band number (as used by the browser) selected by the user, -1: first band of the current group
+    std::atomic<int> selectedBand{-1};
+
     // Flag to stop the thread
     int clientId;
     std::atomic<bool> keepRunning;
@@ -60,9 +117,35 @@ private:
 
     // SignalDecoder: demodulates and returns audio
     SignalDecoder signaldecoder;
-
-    // narrow band FFT processor
-    NarrowFFTProcessor narrowFFT;
+    AudioEncoder audioEncoder;      // audio format selected by the browser
+
+    std::shared_ptr<ClientTXQueue> txQueue;
+
+    // waterfall format selected by the browser: 0 = float, else the version of the compressed format
+    std::atomic<int> waterfallFormat{0};
+    std::atomic<bool> carriersWanted{false};    // pages which cannot show it do not get it
+    std::atomic<bool> historyWanted{false};     // the same for the waterfall history
+    WaterfallEncoder narrowEncoder{1};
+
+    // spectrum window selected by the browser: Hz above the band start, span 0 = whole band (shared topic)
+    // written by the client task, read by the ClientManager thread, always as a whole
+    struct SpectrumWindow {
+        float start = 0.0f;
+        float span = 0.0f;
+        unsigned int width = 1024;
+    };
+    std::mutex windowMutex;
+    SpectrumWindow window;
+    std::atomic<bool> windowActive{false};      // window.span > 0
+    std::atomic<bool> windowChanged{false};     // the next window line is a keyframe
+    WaterfallEncoder windowEncoder{0};          // used by the ClientManager thread only
+
+    // narrow band FFT processor (own FFT), not used in the narrowFromWideband mode
+    std::unique_ptr<NarrowFFTProcessor> narrowFFT;
+
+    // cuts the small waterfall out of the big FFT (narrowFromWideband mode)
+    NarrowSpectrumSlicer narrowSlicer;
+    std::atomic<float> narrowShift{0.0f};   // tuner shift, read by the ClientManager
 };
 
 #endif // CLIENTOBJECT_H
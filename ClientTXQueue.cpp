@@ -0,0 +1,53 @@
+#include "ClientTXQueue.h"
+
+bool ClientTXQueue::push(const ClientTXData& data, Priority prio) {
+    bool ret;
+    switch (prio) {
+        case AUDIO:     ret = audioRing.push(data); break;
+        case WATERFALL: ret = waterfallRing.push(data); break;
+        default:        ret = windowRing.push(data); break;
+    }
+    if (!ret) dropped[prio]++;
+    return ret;
+}
+
+bool ClientTXQueue::pop(ClientTXData& data, Priority prio) {
+    switch (prio) {
+        case AUDIO:     return audioRing.pop(data);
+        case WATERFALL: return waterfallRing.pop(data);
+        default:        return windowRing.pop(data);
+    }
+}
+
+unsigned int ClientTXQueue::discard(Priority prio) {
+    auto ignore = [](const ClientTXData&) {};
+    unsigned int num;
+    switch (prio) {
+        case AUDIO:     num = audioRing.consume_all(ignore); break;
+        case WATERFALL: num = waterfallRing.consume_all(ignore); break;
+        default:        num = windowRing.consume_all(ignore); break;
+    }
+    dropped[prio] += num;
+    return num;
+}
+
+void ClientTXQueue::setBurst(WaterfallBurst newBurst) {
+    std::lock_guard<std::mutex> lock(burstMutex);
+    burst = std::move(newBurst);
+    hasBurst = true;
+}
+
+bool ClientTXQueue::nextBurstFrame(std::string_view& frame) {
+    if (hasBurst) {
+        std::lock_guard<std::mutex> lock(burstMutex);
+        sending = std::move(burst);
+        sendPos = 0;
+        hasBurst = false;
+    }
+    if (!sending || sendPos >= sending->size()) {
+        sending.reset();
+        return false;
+    }
+    frame = (*sending)[sendPos++];
+    return true;
+}
@@ -0,0 +1,62 @@
+#ifndef CLIENT_TX_QUEUE_H
+#define CLIENT_TX_QUEUE_H
+
+#include <atomic>
+#include <mutex>
+#include <string_view>
+#include <cstdint>
+#include <boost/lockfree/spsc_queue.hpp>
+#include "global.h"
+#include "WaterfallHistory.h"
+
+// outbound frames of one browser client, emptied by the WebSocket thread
+// one SPSC ring per priority, so a slow or busy client only loses its own frames:
+//   AUDIO:     configuration and audio, pushed by the task of the ClientObject
+//   WATERFALL: narrow waterfall, pushed by the task of the ClientObject
+//              or by the ClientManager thread (narrowFromWideband), never by both
+//   WINDOW:    wideband lines of the own spectrum window, pushed by the ClientManager thread
+// and a waterfall history burst, sent after everything else while the socket is idle
+// created by the WebSocketServer on connect, shared with the ClientObject
+class ClientTXQueue {
+public:
+    enum Priority { AUDIO = 0, WATERFALL = 1, WINDOW = 2, NUM_PRIORITIES = 3 };
+
+    explicit ClientTXQueue(int clientId) : clientId(clientId) {}
+
+    // producer: copy a frame into the ring, counts and returns false if it is full
+    bool push(const ClientTXData& data, Priority prio);
+
+    // consumer: next frame of a priority
+    bool pop(ClientTXData& data, Priority prio);
+
+    // consumer: throw away the waiting frames of a priority (client cannot keep up), returns the number
+    unsigned int discard(Priority prio);
+
+    // producer (ClientManager thread): history lines for a new client, replaces a waiting burst
+    void setBurst(WaterfallBurst burst);
+
+    // consumer: next frame of the burst, valid until the next call
+    bool nextBurstFrame(std::string_view& frame);
+
+    // frames lost because the ring was full or the client too slow
+    uint64_t getDropped(Priority prio) const { return dropped[prio]; }
+
+    const int clientId;
+
+private:
+    // 16 frames are about 2 s of audio with 1024 sample frames
+    boost::lockfree::spsc_queue<ClientTXData, boost::lockfree::capacity<16>> audioRing;
+    // a waterfall line is only useful for a short time
+    boost::lockfree::spsc_queue<ClientTXData, boost::lockfree::capacity<8>> waterfallRing;
+    boost::lockfree::spsc_queue<ClientTXData, boost::lockfree::capacity<8>> windowRing;
+
+    std::atomic<uint64_t> dropped[NUM_PRIORITIES] = {};
+
+    std::mutex burstMutex;
+    WaterfallBurst burst;       // waiting burst
+    WaterfallBurst sending;     // burst of the consumer
+    size_t sendPos = 0;
+    std::atomic<bool> hasBurst{false};
+};
+
+#endif // CLIENT_TX_QUEUE_H
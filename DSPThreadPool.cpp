@@ -0,0 +1,92 @@
+#include "DSPThreadPool.h"
+#include "global.h"
+#include <stdio.h>
+
+// index of the worker which runs on this thread, -1 for other threads
+static thread_local int currentWorker = -1;
+
+// Singleton instance
+DSPThreadPool& DSPThreadPool::getInstance() {
+    static DSPThreadPool instance;
+    return instance;
+}
+
+DSPThreadPool::~DSPThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(sleepMutex);
+        running = false;
+    }
+    wakeup.notify_all();
+    for (auto& t : threads) {
+        if (t.joinable()) t.join();
+    }
+}
+
+void DSPThreadPool::start(unsigned int numThreads) {
+    if (numThreads == 0) numThreads = std::thread::hardware_concurrency();
+    if (numThreads == 0) numThreads = 2;
+
+    for (unsigned int i = 0; i < numThreads; i++) {
+        workers.push_back(std::make_unique<Worker>());
+    }
+    running = true;
+    for (unsigned int i = 0; i < numThreads; i++) {
+        threads.emplace_back(&DSPThreadPool::workerThread, this, i);
+    }
+    printf("DSP thread pool: %u workers\n", numThreads);
+}
+
+void DSPThreadPool::submit(std::function<void()> task) {
+    unsigned int index = currentWorker >= 0 ? static_cast<unsigned int>(currentWorker)
+                                            : nextWorker++ % workers.size();
+    {
+        std::lock_guard<std::mutex> lock(workers[index]->mutex);
+        workers[index]->tasks.push_back(std::move(task));
+    }
+    pending++;
+
+    // lock, so the wakeup cannot get lost between the check and the wait of a worker
+    { std::lock_guard<std::mutex> lock(sleepMutex); }
+    wakeup.notify_one();
+}
+
+// newest task of the own queue
+bool DSPThreadPool::popLocal(unsigned int index, std::function<void()>& task) {
+    Worker& w = *workers[index];
+    std::lock_guard<std::mutex> lock(w.mutex);
+    if (w.tasks.empty()) return false;
+    task = std::move(w.tasks.back());
+    w.tasks.pop_back();
+    return true;
+}
+
+// oldest task of another worker
+bool DSPThreadPool::steal(unsigned int index, std::function<void()>& task) {
+    for (size_t i = 1; i < workers.size(); i++) {
+        Worker& w = *workers[(index + i) % workers.size()];
+        std::lock_guard<std::mutex> lock(w.mutex);
+        if (!w.tasks.empty()) {
+            task = std::move(w.tasks.front());
+            w.tasks.pop_front();
+            return true;
+        }
+    }
+    return false;
+}
+
+void DSPThreadPool::workerThread(unsigned int index) {
+    currentWorker = static_cast<int>(index);
+    std::function<void()> task;
+
+    while (running) {
+        if (popLocal(index, task) || steal(index, task)) {
+            pending--;
+            task();
+            task = nullptr;     // release the captured objects now
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(sleepMutex);
+        wakeup.wait(lock, [this] { return pending > 0 || !running; });
+    }
+}
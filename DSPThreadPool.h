@@ -0,0 +1,55 @@
+#ifndef DSP_THREAD_POOL_H
+#define DSP_THREAD_POOL_H
+
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <atomic>
+#include <memory>
+
+// Fixed number of worker threads for the per-client DSP work (tuning, demodulation, narrow FFT)
+// every worker has its own task queue, tasks submitted by a worker go into its own queue (LIFO, cache warm),
+// other tasks are distributed round robin. An idle worker steals the oldest task of another worker.
+class DSPThreadPool {
+public:
+    static DSPThreadPool& getInstance();
+
+    // start the workers, 0: one per CPU core
+    void start(unsigned int numThreads = 0);
+
+    // run the task on one of the workers
+    void submit(std::function<void()> task);
+
+    unsigned int getNumThreads() const { return static_cast<unsigned int>(workers.size()); }
+
+private:
+    DSPThreadPool() = default;
+    ~DSPThreadPool();
+
+    DSPThreadPool(const DSPThreadPool&) = delete;
+    DSPThreadPool& operator=(const DSPThreadPool&) = delete;
+
+    struct Worker {
+        std::mutex mutex;
+        std::deque<std::function<void()>> tasks;
+    };
+
+    void workerThread(unsigned int index);
+    bool popLocal(unsigned int index, std::function<void()>& task);
+    bool steal(unsigned int index, std::function<void()>& task);
+
+    std::vector<std::unique_ptr<Worker>> workers;
+    std::vector<std::thread> threads;
+    std::atomic<unsigned int> nextWorker{0};
+
+    // number of queued tasks, the workers sleep if it is 0
+    std::atomic<int> pending{0};
+    std::mutex sleepMutex;
+    std::condition_variable wakeup;
+    std::atomic<bool> running{false};
+};
+
+#endif // DSP_THREAD_POOL_H
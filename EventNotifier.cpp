@@ -0,0 +1,39 @@
+#include "EventNotifier.h"
+#include <sys/eventfd.h>
+#include <poll.h>
+#include <unistd.h>
+#include <stdio.h>
+#include <cstdint>
+
+EventNotifier::EventNotifier() {
+    fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (fd < 0) {
+        perror("EventNotifier: eventfd");
+    }
+}
+
+EventNotifier::~EventNotifier() {
+    if (fd >= 0) close(fd);
+}
+
+void EventNotifier::notify() {
+    // the pushed data must be visible before the sleeping flag is read
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (sleeping.exchange(false)) {
+        uint64_t one = 1;
+        if (write(fd, &one, sizeof(one)) < 0) {
+            // counter overflow is impossible, the consumer is woken up anyway
+        }
+    }
+}
+
+void EventNotifier::block(int timeoutMs) {
+    pollfd pfd = {fd, POLLIN, 0};
+    poll(&pfd, 1, timeoutMs);
+
+    // reset the counter, pending events are covered by the queue checks of the consumer
+    uint64_t value;
+    if (read(fd, &value, sizeof(value)) < 0) {
+        // EAGAIN: timeout, nothing to reset
+    }
+}
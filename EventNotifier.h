@@ -0,0 +1,41 @@
+#ifndef EVENT_NOTIFIER_H
+#define EVENT_NOTIFIER_H
+
+#include <atomic>
+
+// Wakes up a consumer thread which waits for data in its lock-free queue(s)
+// the producers call notify() after a push, the consumer calls wait() if its queues are empty.
+// The eventfd is only written if the consumer really sleeps, so notify() is just an
+// atomic operation while the consumer is busy. Can be used by any number of producers.
+class EventNotifier {
+public:
+    EventNotifier();
+    ~EventNotifier();
+
+    EventNotifier(const EventNotifier&) = delete;
+    EventNotifier& operator=(const EventNotifier&) = delete;
+
+    // producer: call after the data was pushed into the queue
+    void notify();
+
+    // consumer: sleep until notify() is called or the timeout (ms, -1: none) elapsed
+    // ready() checks the queues, it is called after the consumer has announced
+    // that it goes to sleep, so a notify() between the check and the sleep is not lost
+    template <typename Ready>
+    void wait(Ready ready, int timeoutMs) {
+        sleeping.store(true);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (!ready()) {
+            block(timeoutMs);
+        }
+        sleeping.store(false);
+    }
+
+private:
+    void block(int timeoutMs);
+
+    int fd = -1;
+    std::atomic<bool> sleeping{false};
+};
+
+#endif // EVENT_NOTIFIER_H
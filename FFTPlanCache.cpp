@@ -0,0 +1,86 @@
+#include "FFTPlanCache.h"
+#include "FFTProcessor.h"
+#include "Channelizer.h"
+#include <stdio.h>
+#include <chrono>
+
+using namespace std::chrono;
+
+// size of the narrow band FFT of every client (see NarrowFFTProcessor)
+const int NARROW_FFT_SIZE = 8192;
+
+// Singleton instance
+FFTPlanCache& FFTPlanCache::getInstance() {
+    static FFTPlanCache instance;
+    return instance;
+}
+
+FFTPlanCache::~FFTPlanCache() {
+    for (auto& p : plans) fftwf_destroy_plan(p.second);
+}
+
+// must be called with the plannerMutex locked
+fftwf_plan FFTPlanCache::createPlan(int size, int direction) {
+    fftwf_complex* in = (fftwf_complex*) fftwf_malloc(sizeof(fftwf_complex) * size);
+    fftwf_complex* out = (fftwf_complex*) fftwf_malloc(sizeof(fftwf_complex) * size);
+
+    // try the wisdom first, measure only if there is none for this size
+    fftwf_plan plan = fftwf_plan_dft_1d(size, in, out, direction, FFT_PLANNER_FLAGS | FFTW_WISDOM_ONLY);
+    if (!plan) {
+        auto start = steady_clock::now();
+        plan = fftwf_plan_dft_1d(size, in, out, direction, FFT_PLANNER_FLAGS);
+        printf("FFT size %d %s planned in %.1f s\n", size, direction == FFTW_FORWARD ? "forward" : "backward",
+               duration_cast<duration<float>>(steady_clock::now() - start).count());
+        wisdomChanged = true;
+    }
+
+    fftwf_free(in);
+    fftwf_free(out);
+    plans[{size, direction}] = plan;
+    return plan;
+}
+
+void FFTPlanCache::planAll() {
+    std::lock_guard<std::mutex> lock(plannerMutex);
+
+    if (fftwf_import_wisdom_from_filename(FFT_WISDOM_FILE)) {
+        printf("FFT wisdom loaded from %s\n", FFT_WISDOM_FILE);
+    } else {
+        printf("no FFT wisdom found, measuring the FFTs, this takes some time ...\n");
+    }
+
+    const std::pair<int, int> sizes[] = {
+        {FFT_SIZE, FFTW_FORWARD},                       // big waterfall
+        {FFT_SIZE / 2, FFTW_FORWARD},                   // big waterfall of narrow bands (SpanDecimator)
+        {FFT_SIZE / 4, FFTW_FORWARD},
+        {FFT_SIZE / 8, FFTW_FORWARD},
+        {FFT_SIZE / 16, FFTW_FORWARD},
+        {FFT_SIZE / 32, FFTW_FORWARD},                  // 630 m
+        {FFT_SIZE / 64, FFTW_FORWARD},
+        {CHANNELIZER_FFT_SIZE, FFTW_FORWARD},           // Channelizer
+        {CHANNELIZER_IFFT_SIZE, FFTW_BACKWARD},         // Tuner
+        {NARROW_FFT_SIZE, FFTW_FORWARD},                // small waterfall
+    };
+    for (const auto& s : sizes) {
+        if (plans.find(s) == plans.end()) createPlan(s.first, s.second);
+    }
+
+    if (wisdomChanged) {
+        if (fftwf_export_wisdom_to_filename(FFT_WISDOM_FILE)) {
+            printf("FFT wisdom saved to %s\n", FFT_WISDOM_FILE);
+        } else {
+            printf("cannot save the FFT wisdom to %s\n", FFT_WISDOM_FILE);
+        }
+        wisdomChanged = false;
+    }
+}
+
+fftwf_plan FFTPlanCache::getPlan(int size, int direction) {
+    std::lock_guard<std::mutex> lock(plannerMutex);
+
+    auto it = plans.find({size, direction});
+    if (it != plans.end()) return it->second;
+
+    printf("FFTPlanCache: size %d was not planned at startup\n", size);
+    return createPlan(size, direction);
+}
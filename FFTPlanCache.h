@@ -0,0 +1,43 @@
+#ifndef FFT_PLAN_CACHE_H
+#define FFT_PLAN_CACHE_H
+
+#include <map>
+#include <mutex>
+#include <utility>
+#include <fftw3.h>
+
+// measured FFTW plans, shared by all FFT users
+// all sizes are planned once at program start (planAll), the wisdom is stored in
+// a file, so only the very first start needs the time for the measurements
+// the plans are out of place and executed with fftwf_execute_dft() on the
+// buffers of the user, which must be allocated with fftwf_malloc()
+const char* const FFT_WISDOM_FILE = "kwWebSDR.wisdom";
+const unsigned int FFT_PLANNER_FLAGS = FFTW_MEASURE;   // FFTW_PATIENT: slower planning, sometimes faster FFTs
+
+class FFTPlanCache {
+public:
+    static FFTPlanCache& getInstance();
+
+    // load the wisdom, plan all FFT sizes of the program and save new wisdom
+    void planAll();
+
+    // plan for size and direction (FFTW_FORWARD/FFTW_BACKWARD), owned by the cache
+    // sizes which were not planned by planAll() are planned on the first call
+    fftwf_plan getPlan(int size, int direction);
+
+private:
+    FFTPlanCache() = default;
+    ~FFTPlanCache();
+
+    FFTPlanCache(const FFTPlanCache&) = delete;
+    FFTPlanCache& operator=(const FFTPlanCache&) = delete;
+
+    fftwf_plan createPlan(int size, int direction);
+
+    // the FFTW planner is not thread safe
+    std::mutex plannerMutex;
+    std::map<std::pair<int, int>, fftwf_plan> plans;
+    bool wisdomChanged = false;
+};
+
+#endif // FFT_PLAN_CACHE_H
@@ -1,25 +1,36 @@
 #include "FFTProcessor.h"
 #include "ClientManager.h"
+#include "FFTPlanCache.h"
 #include "global.h"
 #include <iostream>
 #include <algorithm>
-#include <stdexcept>
 #include <vector>
+#include <memory>
 #include <chrono>
 
 using std::vector;
 using std::complex;
 namespace chrono = std::chrono;
 
-// Singleton instance
-FFTProcessor& FFTProcessor::getInstance() {
-    static FFTProcessor instance;
-    return instance;
+// one instance per virtual band
+FFTProcessor& FFTProcessor::getInstance(int vband) {
+    static FFTProcessor instances[MAX_VBANDS];
+    static bool initialized = [] {
+        for (int i = 0; i < MAX_VBANDS; i++) instances[i].vband = i;
+        return true;
+    }();
+    (void)initialized;
+    return instances[vband];
 }
 
 // Constructor
-FFTProcessor::FFTProcessor() : fftPlan(nullptr), fftOut(nullptr) {
-    lastUpdateTime = chrono::steady_clock::now();
+FFTProcessor::FFTProcessor() : kernels(getSIMDKernels()), fftPlan(nullptr), fftIn(nullptr), fftOut(nullptr),
+    frame(FFT_SIZE), window(FFT_SIZE), powerSum(FFT_SIZE, 0.0f),
+    binEdges(WATERFALL_BINS + 1), displayPower(WATERFALL_BINS) {
+    // Hamming window
+    for (int i = 0; i < FFT_SIZE; ++i) {
+        window[i] = 0.54f - 0.46f * std::cos(2 * M_PI * i / (FFT_SIZE - 1));
+    }
 }
 
 // Destructor (clean up FFT resources)
@@ -29,15 +40,17 @@ FFTProcessor::~FFTProcessor() {
 
 // Initialize the FFT resources
 void FFTProcessor::initFFT() {
+    fftIn = (fftwf_complex*) fftwf_malloc(sizeof(fftwf_complex) * FFT_SIZE);
     fftOut = (fftwf_complex*) fftwf_malloc(sizeof(fftwf_complex) * FFT_SIZE);
-    fftPlan = fftwf_plan_dft_1d(FFT_SIZE, nullptr, fftOut, FFTW_FORWARD, FFTW_ESTIMATE);
+    fftPlan = FFTPlanCache::getInstance().getPlan(FFT_SIZE, FFTW_FORWARD);
 }
 
 // Cleanup FFT resources
 void FFTProcessor::cleanupFFT() {
-    if (fftPlan) {
-        fftwf_destroy_plan(fftPlan);
-        fftPlan = nullptr;
+    fftPlan = nullptr;  // owned by the FFTPlanCache
+    if (fftIn) {
+        fftwf_free(fftIn);
+        fftIn = nullptr;
     }
     if (fftOut) {
         fftwf_free(fftOut);
@@ -45,161 +58,216 @@ void FFTProcessor::cleanupFFT() {
     }
 }
 
-void FFTProcessor::pushFFTinputSamples(SampleData data) {
-    queue480.push(data);
-}
-
-// Apply a Hamming window to the IQ samples
-void FFTProcessor::applyWindow(vector<complex<float>>& data) {
-    for (size_t i = 0; i < data.size(); ++i) {
-        float windowValue = 0.54f - 0.46f * std::cos(2 * M_PI * i / (data.size() - 1));
-        data[i] *= windowValue;
-    }
+bool FFTProcessor::pushFFTinputSamples(const SampleBlockPtr& data) {
+    bool ret = queue480.push(data);
+    notifier.notify();
+    return ret;
 }
 
 // FFT processing thread
+// every input sample is used: the blocks are decimated to the span of the band and streamed
+// into the frame buffer, an FFT is calculated every hop samples and all spectra of
+// an output interval are averaged (Welch method)
 void FFTProcessor::processFFTThread() {
-    SampleData sampleData;
-    vector<complex<float>> iqSamples(FFT_SIZE);
+    SampleBlockPtr sampleData;
 
     while (keeprunning) {
-        int currentIndex = 0;
-        int samplesNeeded = FFT_SIZE;
-
-        // Gather enough samples for FFT
-        while (currentIndex < samplesNeeded && keeprunning) {
-            if (queue480.pop(sampleData)) {
-                for (int i = 0; i < sampleData.numSamples && currentIndex < samplesNeeded; ++i) {
-                    float iValue = static_cast<float>(sampleData.sdata[i].real());
-                    float qValue = static_cast<float>(sampleData.sdata[i].imag());
-                    iqSamples[currentIndex] = complex<float>(iValue, qValue);
-                    ++currentIndex;
-                }
-            } else {
-                // Sleep if no samples are available
-                std::this_thread::sleep_for(chrono::microseconds(1000));
-            }
+        if (!queue480.pop(sampleData)) {
+            // Sleep until samples are available
+            notifier.wait([this] { return queue480.read_available() > 0; }, 100);
+            continue;
+        }
+
+        // narrow bands: only the span of the band at a lower sample rate
+        const unsigned int decimation = spanDecimator.getDecimation();
+        const liquid_float_complex* samples = sampleData->sdata;
+        size_t numSamples = sampleData->numSamples;
+        if (decimation > 1) {
+            decimated.resize(numSamples / decimation + 1);
+            numSamples = spanDecimator.process(samples, numSamples, decimated.data());
+            samples = decimated.data();
         }
 
-        // Perform FFT if enough samples are collected
-        if (currentIndex == FFT_SIZE) {
-            applyWindow(iqSamples);
-
-            // Execute FFT
-            fftwf_execute_dft(fftPlan, reinterpret_cast<fftwf_complex*>(iqSamples.data()), fftOut);
-            // Process FFT output and send to the queue
-            vector<float> rearrangedOutput = rearrange_fft_output(fftOut, FFT_SIZE);
-            //vector<float> downscaledOutput = downscale_fft_bins(rearrangedOutput, 0.0f, 480000.0f, 1024);
-            vector<float> downscaledOutput = downscale_fft_bins_f(rearrangedOutput, 0.0f, (float)(EndQRG - StartQRG), 480000.0f, 1024);
-
-            std::array<float, 1025> bins1024;
-            bins1024[0] = 0.0f;  // ID or timestamp (placeholder)
-            std::copy_n(downscaledOutput.begin(), 1024, bins1024.begin() + 1);
-
-            // Get the current time and check if 100 ms have passed since the last update
-            auto now = chrono::steady_clock::now();
-            if (chrono::duration_cast<chrono::milliseconds>(now - lastUpdateTime).count() >= 100) {
-                // send to the Client Manager
-                ClientManager& CMinstance = ClientManager::getInstance();
-                CMinstance.enqueueFFTData(bins1024);
-
-                lastUpdateTime = now;
+        size_t pos = 0;
+        while (pos < numSamples) {
+            size_t len = std::min(numSamples - pos, static_cast<size_t>(fftSize - frameFill));
+            std::copy_n(samples + pos, len, frame.begin() + frameFill);
+            frameFill += len;
+            pos += len;
+            samplesSinceOutput += len * decimation;
+
+            if (frameFill == fftSize) {
+                processFrame();
+
+                // keep the overlap for the next frame
+                std::copy(frame.begin() + hop, frame.begin() + fftSize, frame.begin());
+                frameFill = fftSize - hop;
+            }
+
+            if (samplesSinceOutput >= FFT_OUTPUT_INTERVAL && numAveraged > 0) {
+                outputSpectrum();
+                samplesSinceOutput = 0;
             }
         }
+        sampleData.reset();     // give the block back to the pool
     }
 
     // Cleanup when the loop exits
     cleanupFFT();
 }
 
-// Function to rearrange FFT output: -24000 Hz to +24000 Hz mapping
-// convert values to dBm
-vector<float> FFTProcessor::rearrange_fft_output(fftwf_complex* fftOut, size_t fftSize) 
-{
-    vector<float> output(fftSize);  // Output vector to hold magnitudes
-    const float calibration_constant = -115.0;
-
-    // First half of FFT (positive frequencies) is at the start of fftOut
-    // Second half (negative frequencies) is at the end of fftOut
-
-    // Copy the negative frequencies (from the second half of fftOut) to the start of output
-    for (size_t i = fftSize / 2; i < fftSize; ++i) {
-        size_t newIndex = i - fftSize / 2;  // Map to the start of the output array
-        float magnitude = std::sqrt(fftOut[i][0] * fftOut[i][0] + fftOut[i][1] * fftOut[i][1]);
-        float dBm = 20 * log10(magnitude) + calibration_constant;
-        output[newIndex] = dBm;  // Place negative frequencies
+// apply the window, execute the FFT and add the power spectrum to the average
+void FFTProcessor::processFrame() {
+    for (int i = 0; i < fftSize; ++i) {
+        fftIn[i][0] = frame[i].real() * window[i];
+        fftIn[i][1] = frame[i].imag() * window[i];
     }
 
-    // Copy the positive frequencies (from the first half of fftOut) to the second half of output
-    for (size_t i = 0; i < fftSize / 2; ++i) {
-        size_t newIndex = i + fftSize / 2;  // Map to the second half of the output array
-        float magnitude = std::sqrt(fftOut[i][0] * fftOut[i][0] + fftOut[i][1] * fftOut[i][1]);
-        float dBm = 20 * log10(magnitude) + calibration_constant;
-        output[newIndex] = dBm;  // Place negative frequencies
-    }
-
-    return output;
+    fftwf_execute_dft(fftPlan, fftIn, fftOut);
+
+    // fftshift while accumulating: negative frequencies (second half of fftOut) first,
+    // bin k of the shifted FFT is powerSum[k - binOffset], bins outside of powerSum are dropped
+    const float* out = reinterpret_cast<const float*>(fftOut);
+    auto accumulate = [this](const float* x, int k, int n) {
+        int j = k - binOffset;
+        int skip = std::max(0, -j);
+        int len = std::min(n, FFT_SIZE - j) - skip;
+        if (len > 0) kernels.powerAccumulate(x + 2 * skip, powerSum.data() + j + skip, len);
+    };
+    accumulate(out + fftSize, 0, fftSize / 2);
+    accumulate(out, fftSize / 2, fftSize / 2);
+    numAveraged++;
 }
 
-// Downscale bins by specifying the frequency
-vector<float> FFTProcessor::downscale_fft_bins_f(const vector<float>& bins, float firstFrequency, float lastFrequency, float maxFrequency, size_t targetSize)
-{
-    //printf("%f  %f\n",firstFrequency,lastFrequency);
-    // Calculate the bin resolution (frequency range per bin)
-    float binResolution = maxFrequency / bins.size();
+// decimation and FFT size for the span of the band: the bins keep the width SAMPLE_RATE / FFT_SIZE,
+// a band of 50 kHz needs a 2048 point FFT at 60 kS/s instead of 16384 points at 480 kS/s
+void FFTProcessor::configureSpan(uint32_t bandwidth) {
+    const unsigned int decimation = SpanDecimator::decimationFor(SAMPLE_RATE, bandwidth);
+    fftSize = FFT_SIZE / decimation;
 
-    // Convert frequencies to bin indices
-    size_t firstBin = static_cast<size_t>(firstFrequency / binResolution);
-    size_t lastBin = static_cast<size_t>(lastFrequency / binResolution);
+    // the band is centered at 0 Hz (VirtualBands), so every bin of the small FFT
+    // is a bin of the full FFT around FFT_SIZE / 2
+    spanDecimator.configure(decimation);
+    binOffset = fftSize / 2 - FFT_SIZE / 2;
 
-    // Ensure lastBin does not exceed the maximum index in the bins array
-    lastBin = std::min(lastBin, bins.size() - 1);
+    // the same overlap as the full FFT, FFT_HOP may be any value 1...FFT_SIZE
+    hop = std::max(1, FFT_HOP * fftSize / FFT_SIZE);
+
+    fftPlan = FFTPlanCache::getInstance().getPlan(fftSize, FFTW_FORWARD);
+    for (int i = 0; i < fftSize; ++i) {
+        window[i] = 0.54f - 0.46f * std::cos(2 * M_PI * i / (fftSize - 1));
+    }
+    frameFill = 0;
 
-    // Call the original downscale function with calculated bin indices
-    return downscale_fft_bins(bins, firstBin, lastBin, targetSize);
+    printf("waterfall %d: %u Hz span, decimation %u, FFT size %d\n", vband, bandwidth, decimation, fftSize);
 }
 
-// Downscale bins by specifying the bin index
-vector<float> FFTProcessor::downscale_fft_bins(const vector<float>& bins, size_t firstBin, size_t lastBin, size_t targetSize = 1024)
-{
-    // Ensure firstBin and lastBin indices are within the bounds of the bins vector
-    if (firstBin >= bins.size() || lastBin >= bins.size() || firstBin > lastBin) {
-        printf("%ld %ld %ld\n",bins.size(),firstBin,lastBin);
-        throw std::invalid_argument("downscale_fft_bins: Invalid bin range specified.");
+// maps the FFT bins of the band (centered at FFT_SIZE / 2) to the 1024 display bins
+// called only if the band has changed
+void FFTProcessor::updateBinMap(uint32_t bandwidth) {
+    const float binResolution = (float)SAMPLE_RATE / FFT_SIZE;
+    bandStart = std::max(FFT_SIZE / 2 - bandwidth / 2 / binResolution, 0.0f);
+    firstBin = static_cast<unsigned int>(std::lround(bandStart));
+    unsigned int numBins = std::min(static_cast<unsigned int>(bandwidth / binResolution) + 1, FFT_SIZE - firstBin);
+    bandBins = numBins;
+    mappedBandwidth = bandwidth;
+
+    // fewer FFT bins than display bins: the center of every display bin between two FFT bins
+    binPositions.clear();
+    if (numBins < WATERFALL_BINS) {
+        binPositions.resize(WATERFALL_BINS);
+        for (int i = 0; i < WATERFALL_BINS; ++i) {
+            float pos = bandStart + (i + 0.5f) * bandwidth / WATERFALL_BINS / binResolution;
+            binPositions[i] = std::min(pos, static_cast<float>(firstBin + numBins - 1));
+        }
+        return;
     }
 
-    // Check that the selected range is at least targetSize
-    if ((lastBin - firstBin + 1) < targetSize) {
-        throw std::invalid_argument("downscale_fft_bins: Selected range must be at least targetSize. Start/End Frequencies too close");
+    float groupSize = static_cast<float>(numBins) / WATERFALL_BINS;
+    for (int i = 0; i <= WATERFALL_BINS; ++i) {
+        binEdges[i] = firstBin + static_cast<unsigned int>(i * groupSize);
     }
+    binEdges[WATERFALL_BINS] = firstBin + numBins;
+}
+
+// average the accumulated spectra and send them to the ClientManager
+void FFTProcessor::outputSpectrum() {
+    const float calibration_constant = -115.0;
 
-    // Calculate the number of bins in the specified range
-    size_t rangeSize = lastBin - firstBin + 1;
-    
-    // Calculate the size of each group within the specified range
-    float groupSize = static_cast<float>(rangeSize) / targetSize;
+    VirtualBands& vbands = VirtualBands::getInstance();
+    uint32_t bandwidth = vbands.getEndQRG(vband) - vbands.getStartQRG(vband);
+    if (bandwidth != mappedBandwidth) {
+        // new span: the accumulated spectra belong to the old one
+        configureSpan(bandwidth);
+        updateBinMap(bandwidth);
+        std::fill(powerSum.begin(), powerSum.end(), 0.0f);
+        numAveraged = 0;
+        carrierOutputs = 0;
+        return;
+    }
 
-    // Result vector to hold the downscaled data
-    vector<float> result;
-    result.reserve(targetSize);
+    // the decimated FFT has fewer points (and the filter less noise), the bins are D^2 lower
+    const float decimation = static_cast<float>(spanDecimator.getDecimation());
+    const float levelOffset = calibration_constant + 20.0f * std::log10(decimation)
+                              - 10.0f * std::log10((float)numAveraged);
+
+    // peak of the FFT bins of every display bin, then the log of only 1024 values,
+    // the division by numAveraged becomes an offset in dB
+    if (binPositions.empty()) {
+        kernels.maxDecimate(powerSum.data(), binEdges.data(), WATERFALL_BINS, displayPower.data());
+    } else {
+        for (int i = 0; i < WATERFALL_BINS; ++i) {
+            unsigned int k = static_cast<unsigned int>(binPositions[i]);
+            unsigned int k2 = std::min(k + 1, firstBin + bandBins - 1);
+            float t = binPositions[i] - k;
+            displayPower[i] = powerSum[k] + t * (powerSum[k2] - powerSum[k]);
+        }
+    }
 
-    // Loop through the specified bins and downscale
-    for (size_t i = 0; i < targetSize; ++i) {
-        // Determine the range of indices within the specified bin range
-        size_t startIdx = firstBin + static_cast<size_t>(i * groupSize);
-        size_t endIdx = firstBin + static_cast<size_t>((i + 1) * groupSize);
+    std::array<float, 1025> bins1024;
+    bins1024[0] = 0.0f;  // ID or timestamp (placeholder)
+    kernels.powerToDb(displayPower.data(), WATERFALL_BINS, 10.0f, levelOffset, bins1024.data() + 1);
+
+    // the small waterfalls of the clients are cut out of the full resolution spectrum
+    std::shared_ptr<const std::vector<float>> fullSpectrum;
+    if (narrowFromWideband) {
+        auto spectrum = std::make_shared<std::vector<float>>(FFT_SIZE);
+        const float scale = decimation * decimation / numAveraged;
+        for (int i = 0; i < FFT_SIZE; ++i) (*spectrum)[i] = powerSum[i] * scale;
+        fullSpectrum = spectrum;
+    }
 
-        // Ensure endIdx does not exceed lastBin
-        endIdx = std::min(endIdx, lastBin + 1);
+    history.addLine(bins1024.data() + 1, vbands.getStartQRG(vband));
 
-        // Find the maximum value in the current group
-        float maxVal = *std::max_element(bins.begin() + startIdx, bins.begin() + endIdx);
+    // all resolutions of the spectrum for the client windows (zoom), in dB like the 1024 bins
+    SpectrumPyramidPtr pyramid;
+    if (pyramidWanted) {
+        fullDb.resize(FFT_SIZE);
+        kernels.powerToDb(powerSum.data(), FFT_SIZE, 10.0f, levelOffset, fullDb.data());
+        pyramid = std::make_shared<SpectrumPyramid>(fullDb.data(), FFT_SIZE, (float)SAMPLE_RATE / FFT_SIZE, bandStart);
+    }
 
-        // Append the maximum value to the result
-        result.push_back(maxVal);
+    // carriers in the full resolution spectrum of the band, a few times per second
+    CarrierList carriers;
+    if (carrierOutputs == 0) carrierPower.assign(bandBins, 0.0f);
+    const float scale = 1.0f / numAveraged;
+    for (unsigned int i = 0; i < bandBins; ++i) carrierPower[i] += powerSum[firstBin + i] * scale;
+    if (++carrierOutputs == CARRIER_OUTPUTS) {
+        auto list = std::make_shared<std::vector<Carrier>>();
+        const float binResolution = (float)SAMPLE_RATE / FFT_SIZE;
+        carrierDetector.detect(carrierPower.data(), bandBins, binResolution, *list);
+        // carrierPower starts at the bin next to the band start
+        for (Carrier& c : *list) c.frequency += (firstBin - bandStart) * binResolution;
+        carriers = list;
+        carrierOutputs = 0;
     }
 
-    return result;
+    // send to the Client Manager
+    ClientManager& CMinstance = ClientManager::getInstance();
+    CMinstance.enqueueFFTData(vband, bins1024, fullSpectrum, pyramid, carriers);
+
+    std::fill(powerSum.begin(), powerSum.end(), 0.0f);
+    numAveraged = 0;
 }
 
 // Start the FFT thread
@@ -7,25 +7,43 @@
 #include <complex>
 #include <chrono>
 #include <thread>
+#include <atomic>
 #include <boost/lockfree/spsc_queue.hpp>
 #include "global.h"
 #include "liquid.h"
+#include "VirtualBands.h"
+#include "SIMDKernels.h"
+#include "EventNotifier.h"
+#include "WaterfallHistory.h"
+#include "SpectrumPyramid.h"
+#include "SpanDecimator.h"
+#include "CarrierDetector.h"
 
 // Constants
 const int SAMPLE_RATE = 480000;   // 480 kS/s
 const int FFT_SIZE = 16384;        // FFT size
+const int FFT_HOP = FFT_SIZE / 2;  // new samples per FFT (50% overlap), 1...FFT_SIZE
+const int FFT_OUTPUT_INTERVAL = SAMPLE_RATE / 10;   // one averaged spectrum every 100 ms
+const int WATERFALL_BINS = 1024;   // bins of the big waterfall
+const int CARRIER_OUTPUTS = 3;     // spectra averaged for one carrier list (about 3 lists per second)
 
 class FFTProcessor {
 public:
-    // Singleton instance
-    static FFTProcessor& getInstance();
+    // one instance (waterfall) per virtual band
+    static FFTProcessor& getInstance(int vband = 0);
     
     void startFFTThread();                  // Start the FFT thread
-    void pushFFTinputSamples(SampleData data);   // push received samples into the FFT input queue
+    bool pushFFTinputSamples(const SampleBlockPtr& data);   // push received samples into the FFT input queue
 
     // Read data from the FFT queue
     bool readFFTQueue(std::array<float, 1025>& data);
 
+    // the last lines of the waterfall, sent to new clients
+    const WaterfallHistory& getHistory() const { return history; }
+
+    // build a SpectrumPyramid with every output, only needed if a client has its own window (ClientManager)
+    void setPyramidWanted(bool wanted) { pyramidWanted = wanted; }
+
 private:
     FFTProcessor();  // Private constructor for Singleton
     ~FFTProcessor(); // Destructor to clean up FFT resources
@@ -40,23 +58,72 @@ private:
     // FFT processing thread
     void processFFTThread();
 
-    // Apply a window to the samples (Hamming window)
-    void applyWindow(std::vector<std::complex<float>>& data);
+    // window, FFT and power accumulation of the current frame
+    void processFrame();
+
+    // send the average of the accumulated spectra
+    void outputSpectrum();
+
+    // recalculate binEdges for a new band
+    void updateBinMap(uint32_t bandwidth);
 
-    std::vector<float> rearrange_fft_output(fftwf_complex* fftOut, size_t fftSize);
-    std::vector<float> downscale_fft_bins_f(const std::vector<float>& bins, float firstFrequency, float lastFrequency, float maxFrequency, size_t targetSize);
-    std::vector<float> downscale_fft_bins(const std::vector<float>& bins, size_t firstBin, size_t lastBin, size_t targetSize);
+    // decimation, FFT size and window for the bandwidth of a new band
+    void configureSpan(uint32_t bandwidth);
 
-    // FFTW plan and output
+    const SIMDKernels& kernels;
+
+    // FFTW plan (shared, from the FFTPlanCache), input and output
     fftwf_plan fftPlan;
+    fftwf_complex* fftIn;
     fftwf_complex* fftOut;
 
+    // the band at the sample rate of its span, FFT of fftSize (FFT_SIZE / decimation) points
+    SpanDecimator spanDecimator;
+    std::vector<liquid_float_complex> decimated;
+    int fftSize = FFT_SIZE;
+    int binOffset = 0;      // bin k of the shifted FFT is powerSum[k - binOffset]
+
+    // streaming framer: the last fftSize samples, after each FFT the
+    // oldest hop samples are dropped, so no sample is lost
+    std::vector<std::complex<float>> frame;
+    int frameFill = 0;
+    int hop = FFT_HOP;
+
+    // Hamming window of fftSize points, calculated for every span
+    std::vector<float> window;
+
+    // Welch average: sum of the power spectra since the last output
+    // already in fftshift order (-240 kHz ... +240 kHz around the band center), narrow bands fill only their span
+    std::vector<float> powerSum;
+    int numAveraged = 0;
+    int samplesSinceOutput = 0;
+
+    // display bin i shows the maximum of powerSum[binEdges[i] ... binEdges[i+1]-1],
+    // bands with fewer FFT bins than display bins (below 30 kHz) are interpolated at binPositions[i]
+    std::vector<unsigned int> binEdges;
+    std::vector<float> binPositions;
+    float bandStart = 0.0f;         // position of the band start in powerSum, in bins
+    unsigned int firstBin = 0;      // the bin next to it
+    unsigned int bandBins = 0;      // FFT bins from the band start to the band end
+    uint32_t mappedBandwidth = 0;
+    std::vector<float> displayPower;
+
     // Queue for samples from the SDRplay callback
     // any number of samples, queue can store 1024 packets
-    boost::lockfree::spsc_queue<SampleData, boost::lockfree::capacity<1024>> queue480;
+    boost::lockfree::spsc_queue<SampleBlockPtr, boost::lockfree::capacity<1024>> queue480;
+    EventNotifier notifier;
+
+    WaterfallHistory history;
+
+    std::atomic<bool> pyramidWanted{false};
+    std::vector<float> fullDb;      // level 0 of the pyramid
+
+    // active carriers of the band, from the average of CARRIER_OUTPUTS spectra
+    CarrierDetector carrierDetector;
+    std::vector<float> carrierPower;
+    int carrierOutputs = 0;
 
-    // Helper variables
-    std::chrono::steady_clock::time_point lastUpdateTime;
+    int vband = 0;
 };
 
 #endif // FFT_PROCESSOR_H
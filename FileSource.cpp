@@ -0,0 +1,132 @@
+#include "FileSource.h"
+#include "IngestProcessor.h"
+#include "global.h"
+#include <chrono>
+#include <cstring>
+#include <cstdint>
+
+using namespace std::chrono;
+
+// 1 ms of samples per chunk
+static const size_t FILE_CHUNK_SIZE = IQ_SOURCE_SAMPLE_RATE / 1000;
+
+FileSource::FileSource(const std::string& filename, bool realtime, bool loop)
+    : filename(filename), realtime(realtime), loop(loop),
+      interleaved(FILE_CHUNK_SIZE * 2), chunkI(FILE_CHUNK_SIZE), chunkQ(FILE_CHUNK_SIZE) {
+}
+
+FileSource::~FileSource() {
+    running = false;
+    if (thread.joinable()) thread.join();
+    if (file) fclose(file);
+}
+
+// reads the header of a WAV file and positions the file at the start of the samples
+// returns false if the format cannot be used
+bool FileSource::readWavHeader() {
+    char riff[12];
+    if (fread(riff, 1, 12, file) != 12 || memcmp(riff, "RIFF", 4) != 0 || memcmp(riff + 8, "WAVE", 4) != 0) {
+        printf("FileSource: %s is not a WAV file\n", filename.c_str());
+        return false;
+    }
+
+    bool fmtOK = false;
+    char id[4];
+    uint32_t len;
+    while (fread(id, 1, 4, file) == 4 && fread(&len, 4, 1, file) == 1) {
+        if (memcmp(id, "fmt ", 4) == 0) {
+            uint8_t fmt[16];
+            if (len < 16 || fread(fmt, 1, 16, file) != 16) return false;
+            uint16_t format = fmt[0] | (fmt[1] << 8);
+            uint16_t channels = fmt[2] | (fmt[3] << 8);
+            uint32_t rate = fmt[4] | (fmt[5] << 8) | (fmt[6] << 16) | ((uint32_t)fmt[7] << 24);
+            uint16_t bits = fmt[14] | (fmt[15] << 8);
+            if (format != 1 || channels != 2 || bits != 16) {
+                printf("FileSource: WAV file must be 2 channel 16 bit PCM\n");
+                return false;
+            }
+            if (rate != IQ_SOURCE_SAMPLE_RATE) {
+                printf("FileSource: WARNING sample rate of the file is %u, replayed as %u\n", rate, IQ_SOURCE_SAMPLE_RATE);
+            }
+            fmtOK = true;
+            fseek(file, len - 16 + (len & 1), SEEK_CUR);
+        }
+        else if (memcmp(id, "data", 4) == 0) {
+            dataStart = ftell(file);
+            dataLength = len;
+            return fmtOK;
+        }
+        else {
+            fseek(file, len + (len & 1), SEEK_CUR);
+        }
+    }
+    printf("FileSource: no data chunk found in %s\n", filename.c_str());
+    return false;
+}
+
+bool FileSource::init(uint32_t frequency) {
+    file = fopen(filename.c_str(), "rb");
+    if (!file) {
+        printf("FileSource: cannot open %s\n", filename.c_str());
+        return false;
+    }
+
+    std::string ext = filename.size() > 4 ? filename.substr(filename.size() - 4) : "";
+    if (ext == ".wav" || ext == ".WAV") {
+        if (!readWavHeader()) return false;
+    }
+
+    printf("replaying %s %s%s\n", filename.c_str(), realtime ? "in real time" : "as fast as possible", loop ? " (endless)" : "");
+
+    running = true;
+    thread = std::thread(&FileSource::replayThread, this);
+    return true;
+}
+
+// reads up to FILE_CHUNK_SIZE samples and splits them into I and Q
+// returns the number of samples, 0 at the end of the data
+size_t FileSource::readChunk() {
+    size_t want = FILE_CHUNK_SIZE;
+    if (dataLength >= 0) {
+        long left = dataStart + dataLength - ftell(file);
+        want = std::min(want, static_cast<size_t>(std::max(left, 0L)) / 4);
+    }
+    size_t n = fread(interleaved.data(), 4, want, file);
+    for (size_t i = 0; i < n; i++) {
+        chunkI[i] = interleaved[2 * i];
+        chunkQ[i] = interleaved[2 * i + 1];
+    }
+    return n;
+}
+
+void FileSource::replayThread() {
+    IngestProcessor& ingest = IngestProcessor::getInstance();
+    uint64_t totalSamples = 0;
+    auto start = steady_clock::now();
+
+    while (running && keeprunning) {
+        size_t n = readChunk();
+        if (n == 0) {
+            if (!loop) break;
+            fseek(file, dataStart, SEEK_SET);
+            continue;
+        }
+
+        if (realtime) {
+            // the samples of this chunk are due when the previous ones have been played
+            std::this_thread::sleep_until(start + microseconds(totalSamples * 1000000 / IQ_SOURCE_SAMPLE_RATE));
+        } else {
+            // as fast as possible, but without losing samples
+            while (ingest.getRawRingSpace() < n && running) {
+                std::this_thread::sleep_for(microseconds(100));
+            }
+        }
+
+        ingest.pushRawSamples(chunkI.data(), chunkQ.data(), n, 0);
+        totalSamples += n;
+    }
+
+    double seconds = duration_cast<duration<double>>(steady_clock::now() - start).count();
+    printf("file replay finished: %lu samples in %.2f s (%.2f MS/s)\n",
+           (unsigned long)totalSamples, seconds, totalSamples / seconds / 1e6);
+}
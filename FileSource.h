@@ -0,0 +1,44 @@
+#ifndef FILE_SOURCE_H
+#define FILE_SOURCE_H
+
+#include <string>
+#include <thread>
+#include <atomic>
+#include <vector>
+#include <cstdio>
+#include "IQSource.h"
+
+// replays a recording of 2.4 MS/s I/Q samples
+// raw files: interleaved int16 I/Q (cs16), WAV files: 2 channels, 16 bit PCM
+class FileSource : public IQSource {
+public:
+    // realtime: pace the samples like the hardware, otherwise as fast as the ingest thread can take them
+    // loop: start again at the end of the file
+    FileSource(const std::string& filename, bool realtime, bool loop);
+    ~FileSource() override;
+
+    bool init(uint32_t frequency) override;
+    void setFrequency(uint32_t frequency) override {}
+    const char* getName() const override { return "file replay"; }
+
+private:
+    bool readWavHeader();
+    size_t readChunk();
+    void replayThread();
+
+    std::string filename;
+    bool realtime;
+    bool loop;
+    FILE* file = nullptr;
+    long dataStart = 0;         // file offset of the first sample
+    long dataLength = -1;       // length of the sample data in bytes, -1 = up to the end of file
+
+    std::vector<short> interleaved;
+    std::vector<short> chunkI;
+    std::vector<short> chunkQ;
+
+    std::thread thread;
+    std::atomic<bool> running{false};
+};
+
+#endif // FILE_SOURCE_H
@@ -0,0 +1,26 @@
+#ifndef IQ_SOURCE_H
+#define IQ_SOURCE_H
+
+#include <cstdint>
+
+// sample rate of all IQ sources, the IngestProcessor decimates it to 480 kS/s
+const uint32_t IQ_SOURCE_SAMPLE_RATE = 2400000;
+
+// Abstract source of 2.4 MS/s int16 I/Q samples
+// a source delivers its samples to IngestProcessor::pushRawSamples(),
+// from there they take the same path as the samples of the SDR hardware
+class IQSource {
+public:
+    virtual ~IQSource() = default;
+
+    // open the device or file and start streaming
+    virtual bool init(uint32_t frequency) = 0;
+
+    // tune to a new center frequency (ignored by sources which cannot tune)
+    virtual void setFrequency(uint32_t frequency) = 0;
+
+    // name for the log output
+    virtual const char* getName() const = 0;
+};
+
+#endif // IQ_SOURCE_H
@@ -0,0 +1,103 @@
+#include "IngestDecimator.h"
+#include <algorithm>
+#include <numeric>
+#include <cstring>
+#include <cmath>
+#include <cstdlib>
+
+// input sample rate
+static const int32_t INGEST_INPUT_RATE = 2400000;
+
+// Constructor: design the decimation filter
+IngestDecimator::IngestDecimator(const SIMDKernels& simdKernels) :
+    kernels(simdKernels),
+    taps(NUM_TAPS),
+    bufI(NUM_TAPS + DECIMATION + BLOCK_SIZE, 0.0f),
+    bufQ(NUM_TAPS + DECIMATION + BLOCK_SIZE, 0.0f),
+    fill(NUM_TAPS - 1) {
+
+    // lowpass with the -6 dB point at 240 kHz (fc = 0.1 at 2.4 MS/s)
+    // passband up to about 200 kHz, stopband from about 280 kHz,
+    // so nothing aliases into +-200 kHz, bands up to 400 kHz are centered in it (VirtualBands)
+    // wider bands (15 m, 11 m and the 480 kHz segments) reach into the transition band:
+    // their outer 20...40 kHz are attenuated and get signals from beyond the segment edge,
+    // e.g. a tone at +250 kHz appears at -230 kHz only 12 dB down
+    std::vector<float> h(NUM_TAPS);
+    liquid_firdes_kaiser(NUM_TAPS, 0.1f, 60.0f, 0.0f, h.data());
+
+    float sum = 0.0f;
+    for (float v : h) sum += v;
+
+    // the kernels calculate a dot product, so the taps are stored in reversed order
+    for (unsigned int i = 0; i < NUM_TAPS; i++) {
+        taps[i] = h[NUM_TAPS - 1 - i] / sum;
+    }
+}
+
+void IngestDecimator::setFrequencyOffset(int32_t offset) {
+    frequencyOffset = offset;
+    mixPhase = 0;
+    if (offset == 0) {
+        mixPeriod = 0;
+        mixCos.clear();
+        mixSin.clear();
+        return;
+    }
+
+    // the mixer repeats after INGEST_INPUT_RATE / gcd(offset, INGEST_INPUT_RATE) samples
+    // (24 samples for a 500 kHz offset)
+    mixPeriod = INGEST_INPUT_RATE / std::gcd(std::abs(offset), INGEST_INPUT_RATE);
+    mixCos.resize(mixPeriod + BLOCK_SIZE);
+    mixSin.resize(mixPeriod + BLOCK_SIZE);
+    for (unsigned int i = 0; i < mixPeriod + BLOCK_SIZE; i++) {
+        // the phase is calculated from i % mixPeriod, so the table is exactly periodic
+        double phase = -2.0 * M_PI * static_cast<double>(offset) * (i % mixPeriod) / INGEST_INPUT_RATE;
+        mixCos[i] = static_cast<float>(std::cos(phase));
+        mixSin[i] = static_cast<float>(std::sin(phase));
+    }
+}
+
+unsigned int IngestDecimator::process(const short *xi, const short *xq, unsigned int numSamples, liquid_float_complex *output) {
+    unsigned int numOut = 0;
+    unsigned int pos = 0;
+    while (pos < numSamples) {
+        unsigned int len = std::min(numSamples - pos, BLOCK_SIZE);
+        numOut += processBlock(xi + pos, xq + pos, len, output + numOut);
+        pos += len;
+    }
+    return numOut;
+}
+
+unsigned int IngestDecimator::processBlock(const short *xi, const short *xq, unsigned int numSamples, liquid_float_complex *output) {
+    // convert and remove the DC offset, append to the filter history
+    float sumI, sumQ;
+    kernels.convertInt16(xi, xq, numSamples, 1.0f / 32768.0f, dcI, dcQ,
+                         &bufI[fill], &bufQ[fill], &sumI, &sumQ);
+
+    // shift the wanted segment to 0 Hz
+    if (mixPeriod) {
+        kernels.mixPlanar(&bufI[fill], &bufQ[fill], &mixCos[mixPhase], &mixSin[mixPhase], numSamples);
+        mixPhase = (mixPhase + numSamples) % mixPeriod;
+    }
+    fill += numSamples;
+
+    // slow update of the DC estimation with the mean of this block
+    dcI += dcAlpha * (sumI / numSamples - dcI);
+    dcQ += dcAlpha * (sumQ / numSamples - dcQ);
+
+    // every 5th input sample completes a window of NUM_TAPS samples
+    unsigned int numOut = 0;
+    if (fill >= NUM_TAPS) {
+        numOut = (fill - NUM_TAPS) / DECIMATION + 1;
+        kernels.firDecimate(bufI.data(), bufQ.data(), taps.data(), NUM_TAPS, numOut, DECIMATION,
+                            reinterpret_cast<float*>(output));
+    }
+
+    // keep the samples which are needed for the next output
+    unsigned int consumed = numOut * DECIMATION;
+    fill -= consumed;
+    std::memmove(bufI.data(), bufI.data() + consumed, fill * sizeof(float));
+    std::memmove(bufQ.data(), bufQ.data() + consumed, fill * sizeof(float));
+
+    return numOut;
+}
@@ -0,0 +1,60 @@
+#ifndef INGEST_DECIMATOR_H
+#define INGEST_DECIMATOR_H
+
+#include <vector>
+#include <cstdint>
+#include <complex>
+#include "liquid.h"
+#include "SIMDKernels.h"
+
+// 2400 kS/s int16 I/Q to 480 kS/s float I/Q in one cache resident pass:
+// int16 to float conversion, DC offset removal, optional frequency shift and a FIR decimation by 5
+class IngestDecimator {
+public:
+    static constexpr unsigned int DECIMATION = 5;
+    static constexpr unsigned int NUM_TAPS = 120;       // multiple of 8 for the SIMD kernels
+    static constexpr unsigned int BLOCK_SIZE = 2048;    // input samples per step, fits into the L1 cache
+
+    explicit IngestDecimator(const SIMDKernels& simdKernels = getSIMDKernels());
+
+    // process numSamples raw samples, returns the number of output samples
+    // output must have room for numSamples / DECIMATION + 1 samples
+    unsigned int process(const short *xi, const short *xq, unsigned int numSamples, liquid_float_complex *output);
+
+    // shift the input by -offset Hz before the decimation, so a segment
+    // beside the tuner frequency becomes the 480 kS/s baseband (see VirtualBands)
+    void setFrequencyOffset(int32_t offset);
+    int32_t getFrequencyOffset() const { return frequencyOffset; }
+
+    // current DC estimation
+    float getDCOffsetI() const { return dcI; }
+    float getDCOffsetQ() const { return dcQ; }
+
+private:
+    unsigned int processBlock(const short *xi, const short *xq, unsigned int numSamples, liquid_float_complex *output);
+
+    const SIMDKernels& kernels;
+
+    // reversed filter taps
+    std::vector<float> taps;
+
+    // planar input buffers: filter history followed by the new samples
+    std::vector<float> bufI;
+    std::vector<float> bufQ;
+    unsigned int fill;      // valid samples in bufI/bufQ
+
+    // frequency shift: one period of the mixer, followed by BLOCK_SIZE more values,
+    // so a block never wraps around within the table
+    int32_t frequencyOffset = 0;
+    std::vector<float> mixCos;
+    std::vector<float> mixSin;
+    unsigned int mixPeriod = 0;
+    unsigned int mixPhase = 0;
+
+    // DC offset estimation
+    float dcI = 0.0f;
+    float dcQ = 0.0f;
+    const float dcAlpha = 0.001f;   // about 1 s time constant at 2048 sample blocks
+};
+
+#endif // INGEST_DECIMATOR_H
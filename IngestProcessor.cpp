@@ -0,0 +1,133 @@
+#include "IngestProcessor.h"
+#include "FFTProcessor.h"
+#include "ClientManager.h"
+#include "global.h"
+#include <iostream>
+#include <thread>
+#include <chrono>
+#include <cstring>
+#include <algorithm>
+#include <pthread.h>
+#include <sched.h>
+
+using namespace std::chrono;
+
+// Singleton instance
+IngestProcessor& IngestProcessor::getInstance() {
+    static IngestProcessor instance;
+    return instance;
+}
+
+// Constructor
+IngestProcessor::IngestProcessor() :
+    chunkI(INGEST_CHUNK_SIZE),
+    chunkQ(INGEST_CHUNK_SIZE),
+    samplePool(INGEST_BLOCK_SIZE, 1024) {
+}
+
+// Destructor
+IngestProcessor::~IngestProcessor() {
+}
+
+// runs in the SDRplay driver thread: no allocation, no DSP, no locks
+// (notify() only writes to an eventfd if the ingest thread sleeps)
+void IngestProcessor::pushRawSamples(const short *xi, const short *xq, unsigned int numSamples, unsigned int reset) {
+    if (reset) resets++;
+
+    // the ingest thread reads the Q ring last, so it never has more free space than the I ring
+    if (ringQ.write_available() < numSamples) {
+        droppedSamples += numSamples;
+        return;
+    }
+    ringI.push(xi, numSamples);
+    ringQ.push(xq, numSamples);
+    notifier.notify();
+}
+
+// the ingest thread must not be delayed by the client threads
+void IngestProcessor::setRealtimePriority() {
+    sched_param param;
+    param.sched_priority = sched_get_priority_max(SCHED_FIFO) / 2;
+    int ret = pthread_setschedparam(pthread_self(), SCHED_FIFO, &param);
+    if (ret != 0) {
+        printf("IngestProcessor: cannot set real time priority (%s), running with normal priority\n", strerror(ret));
+    }
+}
+
+// convert, shift and downsample the chunk to 480 kS/s directly into a shared sample block
+void IngestProcessor::decimateAndPublish(int vband, unsigned int numSamples) {
+    IngestDecimator& decimator = decimators[vband];
+
+    // the band group was changed
+    int32_t offset = VirtualBands::getInstance().getOffset(vband);
+    if (decimator.getFrequencyOffset() != offset) {
+        decimator.setFrequencyOffset(offset);
+    }
+
+    SampleBlockPtr block = samplePool.acquire();
+    if (!block) {
+        overruns++;
+        return;
+    }
+
+    block.get()->numSamples = decimator.process(chunkI.data(), chunkQ.data(), numSamples, block.get()->sdata);
+    if (block->numSamples == 0) return;
+
+    // both consumers get a handle to the same block, the samples are not copied
+    if (!FFTProcessor::getInstance(vband).pushFFTinputSamples(block)) overruns++;
+    if (!ClientManager::getInstance().enqueueRawSamples(vband, block)) overruns++;
+}
+
+// print the counters if something went wrong since the last call
+void IngestProcessor::printStatistics() {
+    static uint64_t lastDropped = 0, lastOverruns = 0, lastResets = 0;
+
+    uint64_t dropped = droppedSamples, ovr = overruns, rst = resets;
+    if (dropped != lastDropped || ovr != lastOverruns || rst != lastResets) {
+        printf("IngestProcessor: dropped samples: %lu  overruns: %lu  resets: %lu\n",
+               (unsigned long)dropped, (unsigned long)ovr, (unsigned long)rst);
+        lastDropped = dropped;
+        lastOverruns = ovr;
+        lastResets = rst;
+    }
+}
+
+// Ingest thread: raw ring -> float -> 480 kS/s blocks
+void IngestProcessor::processIngestThread() {
+    setRealtimePriority();
+    auto lastStatistics = steady_clock::now();
+
+    while (keeprunning) {
+        // the Q ring is written last, so it never has more samples than the I ring
+        size_t avail = ringQ.read_available();
+        if (avail == 0) {
+            // Sleep until samples are available
+            notifier.wait([this] { return ringQ.read_available() > 0; }, 100);
+        } else {
+            size_t len = std::min(avail, INGEST_CHUNK_SIZE);
+            ringI.pop(chunkI.data(), len);
+            ringQ.pop(chunkQ.data(), len);
+
+            // the extra segments only cost CPU time if somebody listens
+            VirtualBands& vbands = VirtualBands::getInstance();
+            for (int v = 0; v < vbands.getNumVBands(); v++) {
+                if (vbands.hasSubscribers(v)) decimateAndPublish(v, len);
+            }
+        }
+
+        auto now = steady_clock::now();
+        if (duration_cast<seconds>(now - lastStatistics).count() >= 10) {
+            printStatistics();
+            lastStatistics = now;
+        }
+    }
+}
+
+// Start the ingest thread
+void IngestProcessor::startIngestThread() {
+    std::thread ingestThread([this]() {
+        processIngestThread();
+    });
+
+    ingestThread.detach();
+}
@@ -0,0 +1,78 @@
+#ifndef INGEST_PROCESSOR_H
+#define INGEST_PROCESSOR_H
+
+#include <vector>
+#include <array>
+#include <complex>
+#include <atomic>
+#include <cstdint>
+#include <boost/lockfree/spsc_queue.hpp>
+#include "liquid.h"
+#include "SampleBlock.h"
+#include "IngestDecimator.h"
+#include "VirtualBands.h"
+#include "EventNotifier.h"
+
+// raw ring: about 200 ms of 2.4 MS/s I/Q data
+const size_t INGEST_RING_SIZE = 1 << 19;
+
+// max. number of 2.4 MS/s samples processed in one step of the ingest thread
+// the 480 kS/s output of one chunk must fit into one SampleBlock
+const size_t INGEST_CHUNK_SIZE = 4096;
+const size_t INGEST_BLOCK_SIZE = INGEST_CHUNK_SIZE / IngestDecimator::DECIMATION + 1;
+
+// Takes the raw int16 I/Q samples from the SDRplay callback
+// and does the conversion and decimation to 480 kS/s (IngestDecimator) in its own thread
+// one 480 kS/s stream per virtual band, but only for bands which have subscribers
+class IngestProcessor {
+public:
+    static IngestProcessor& getInstance();
+
+    // Start the ingest thread (real time priority if permitted)
+    void startIngestThread();
+
+    // called by the IQ source (e.g. SDRplay stream callback), only copies the samples into the raw ring
+    void pushRawSamples(const short *xi, const short *xq, unsigned int numSamples, unsigned int reset);
+
+    // free space in the raw ring, may only be called by the thread which pushes the samples
+    size_t getRawRingSpace() { return ringQ.write_available(); }
+
+    // statistics
+    uint64_t getDroppedSamples() const { return droppedSamples; }  // raw ring full, samples lost in the callback
+    uint64_t getOverruns() const { return overruns; }              // no free block or consumer queue full
+    uint64_t getResets() const { return resets; }                  // resets reported by the driver
+
+private:
+    IngestProcessor();
+    ~IngestProcessor();
+
+    IngestProcessor(const IngestProcessor&) = delete;
+    IngestProcessor& operator=(const IngestProcessor&) = delete;
+
+    void processIngestThread();
+    void setRealtimePriority();
+    void decimateAndPublish(int vband, unsigned int numSamples);
+    void printStatistics();
+
+    // raw I and Q rings, filled by the callback with a single memcpy each
+    boost::lockfree::spsc_queue<short, boost::lockfree::capacity<INGEST_RING_SIZE>> ringI;
+    boost::lockfree::spsc_queue<short, boost::lockfree::capacity<INGEST_RING_SIZE>> ringQ;
+
+    EventNotifier notifier;
+
+    // working buffers of the ingest thread
+    std::vector<short> chunkI;
+    std::vector<short> chunkQ;
+
+    // conversion, DC removal, shift and decimation 2400 kS/s to 480 kS/s, one per virtual band
+    std::array<IngestDecimator, MAX_VBANDS> decimators;
+
+    // 480 kS/s sample blocks, filled once and shared by the FFTProcessor and the ClientManager
+    SampleBlockPool samplePool;
+
+    std::atomic<uint64_t> droppedSamples{0};
+    std::atomic<uint64_t> overruns{0};
+    std::atomic<uint64_t> resets{0};
+};
+
+#endif // INGEST_PROCESSOR_H
@@ -1,5 +1,7 @@
 #include "NarrowFFT.h"
 #include "WebSocketServer.h"
+#include "FFTPlanCache.h"
+#include "FFTProcessor.h"
 #include <algorithm>
 #include <stdexcept>
 #include <iostream>
@@ -10,23 +12,11 @@ NarrowFFTProcessor::NarrowFFTProcessor(size_t fftSize, float calibrationConstant
     : fftSize_(fftSize), calibrationConstant_(calibrationConstant) {
     fftIn_ = (fftwf_complex*) fftwf_malloc(sizeof(fftwf_complex) * fftSize_);
     fftOut_ = (fftwf_complex*) fftwf_malloc(sizeof(fftwf_complex) * fftSize_);
-    fftPlan_ = fftwf_plan_dft_1d(fftSize_, fftIn_, fftOut_, FFTW_FORWARD, FFTW_ESTIMATE);
+    fftPlan_ = FFTPlanCache::getInstance().getPlan(fftSize_, FFTW_FORWARD);   // planned at startup
     lastUpdate_ = std::chrono::steady_clock::now();
-
-    startProcessing();
 }
 
 NarrowFFTProcessor::~NarrowFFTProcessor() {
-    keepRunning = false;  // Signal the thread to exit
-
-    if (processingThread_.joinable()) {
-        processingThread_.join();  // Wait for fftProcessing thread to finish
-    }
-
-    if (fftPlan_) {
-        fftwf_destroy_plan(fftPlan_);
-        fftPlan_ = nullptr;
-    }
     if (fftIn_) {
         fftwf_free(fftIn_);
         fftIn_ = nullptr;
@@ -37,21 +27,6 @@ NarrowFFTProcessor::~NarrowFFTProcessor() {
     }
 }
 
-
-void NarrowFFTProcessor::startProcessing() {    
-    processingThread_ = std::thread(&NarrowFFTProcessor::fftProcessing, this);
-}
-
-// Pushes sample data into the input queue
-bool NarrowFFTProcessor::pushSampleData(const ClientInfo& data) {
-    if (!narrowInputQueue_.push(data)) {
-        //std::cerr << "Queue is full; dropping data" << std::endl;
-        return false;
-    }
-    return true;
-}
-
-
 std::vector<float> NarrowFFTProcessor::downscaleFftBins(const std::vector<float>& bins, size_t targetSize) {
     if (bins.size() < targetSize * 2) {
         throw std::invalid_argument("Input vector size must be at least 2 * targetSize.");
@@ -89,56 +64,72 @@ std::vector<float> NarrowFFTProcessor::rearrangeFftOutput() {
     return output;
 }
 
-void NarrowFFTProcessor::fftProcessing() {
-    while (keeprunning && keepRunning) {  // Uses the global keeprunning variable
-        ClientInfo data;
-
-        // Attempt to pop data from the narrow input queue
-        if (narrowInputQueue_.pop(data)) {
-            if (data.messageId == 3) {  // Ensure it's raw data before accessing sdata
-                int currentClientID = data.clientId; // Store client ID locally
+// called by the task of the ClientObject, so no own thread and queue are needed
+bool NarrowFFTProcessor::processSamples(const ClientInfo& data, std::array<float, 1025>& bins1024) {
+    if (data.messageId != 3) return false;    // Ensure it's raw data before accessing sdata
+    bool lineReady = false;
 
-                for (const auto& sample : data.sdata) {
-                    sampleBuffer.push_back(sample); // Buffer samples
+    size_t numSamples = data.samples ? data.samples->numSamples : 0;
+    for (size_t s = 0; s < numSamples; s++) {
+        sampleBuffer.push_back(data.samples->sdata[s]); // Buffer samples
 
-                    if (sampleBuffer.size() == fftSize_) {
-                        // Ensure fftIn_ and fftOut_ are allocated before using
-                        if (!fftIn_ || !fftOut_) {
-                            std::cerr << "FFT buffers not allocated!" << std::endl;
-                            return;  // Exit the function if not allocated
-                        }
-
-                        for (size_t i = 0; i < fftSize_; ++i) {
-                            fftIn_[i][0] = sampleBuffer[i].real;
-                            fftIn_[i][1] = sampleBuffer[i].imag;
-                        }
-
-                        fftwf_execute(fftPlan_);
+        if (sampleBuffer.size() == fftSize_) {
+            // Ensure fftIn_ and fftOut_ are allocated before using
+            if (!fftIn_ || !fftOut_) {
+                std::cerr << "FFT buffers not allocated!" << std::endl;
+                return false;  // Exit the function if not allocated
+            }
 
-                        std::vector<float> rearrangedOutput = rearrangeFftOutput();
-                        std::vector<float> downscaledOutput = downscaleFftBins(rearrangedOutput, 1024);
+            for (size_t i = 0; i < fftSize_; ++i) {
+                fftIn_[i][0] = sampleBuffer[i].real();
+                fftIn_[i][1] = sampleBuffer[i].imag();
+            }
 
-                        std::array<float, 1025> bins1024;
-                        bins1024[0] = 1.0f;
-                        std::copy_n(downscaledOutput.begin(), 1024, bins1024.begin() + 1);
+            fftwf_execute_dft(fftPlan_, fftIn_, fftOut_);
 
-                        auto now = std::chrono::steady_clock::now();
-                        if (std::chrono::duration_cast<std::chrono::milliseconds>(now - lastUpdate_).count() >= 100) {
-                            processBinsOutput(bins1024, currentClientID);  // Pass currentClientID
-                            lastUpdate_ = now;
-                        }
+            std::vector<float> rearrangedOutput = rearrangeFftOutput();
+            std::vector<float> downscaledOutput = downscaleFftBins(rearrangedOutput, 1024);
 
-                        sampleBuffer.clear();
-                    }
-                }
+            auto now = std::chrono::steady_clock::now();
+            if (std::chrono::duration_cast<std::chrono::milliseconds>(now - lastUpdate_).count() >= 100) {
+                bins1024[0] = 1.0f;
+                std::copy_n(downscaledOutput.begin(), 1024, bins1024.begin() + 1);
+                lineReady = true;
+                lastUpdate_ = now;
             }
-        } else {
-            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+
+            sampleBuffer.clear();
         }
     }
+    return lineReady;
+}
+
+// +-24 kHz of the 480 kHz spectrum
+static const float SLICE_WIDTH = 48000.0f;
+static const float FULL_BIN_HZ = (float)SAMPLE_RATE / FFT_SIZE;
+static const int SLICE_BINS = static_cast<int>(SLICE_WIDTH / FULL_BIN_HZ) + 2;
+
+NarrowSpectrumSlicer::NarrowSpectrumSlicer()
+    : kernels(getSIMDKernels()), sliceBuffer(SLICE_BINS), binEdges(1025), displayPower(1024) {
+    // about 1.6 FFT bins per display bin, the edges do not depend on the tuned frequency
+    const float binsPerPixel = SLICE_WIDTH / FULL_BIN_HZ / 1024;
+    for (int i = 0; i <= 1024; ++i) {
+        binEdges[i] = static_cast<unsigned int>(i * binsPerPixel);
+    }
 }
 
-void NarrowFFTProcessor::processBinsOutput(const std::array<float, 1025>& bins1024, int clientID) {
-    WebSocketServer& WSSinstance = WebSocketServer::getInstance();
-    WSSinstance.sendDataToClient(bins1024, clientID);
+void NarrowSpectrumSlicer::slice(const std::vector<float>& fullSpectrum, float shift, std::array<float, 1025>& bins1024) {
+    // first FFT bin of the slice, the band center is at FFT_SIZE/2
+    int first = FFT_SIZE / 2 + static_cast<int>(std::floor((shift - SLICE_WIDTH / 2) / FULL_BIN_HZ));
+
+    // copy the slice, bins beyond the band edges are empty
+    for (int i = 0; i < SLICE_BINS; ++i) {
+        int k = first + i;
+        sliceBuffer[i] = (k >= 0 && k < FFT_SIZE) ? fullSpectrum[k] : POWER_MIN;
+    }
+
+    kernels.maxDecimate(sliceBuffer.data(), binEdges.data(), 1024, displayPower.data());
+
+    bins1024[0] = 1.0f;     // ID of the small waterfall
+    kernels.powerToDb(displayPower.data(), 1024, 10.0f, -115.0f, bins1024.data() + 1);
 }
@@ -2,23 +2,21 @@
 #define NARROWFFT_PROCESSOR_H
 
 #include <vector>
-#include <thread>
 #include <chrono>
 #include <cmath>
 #include <fftw3.h>
 #include <array>
-#include <boost/lockfree/spsc_queue.hpp>
 #include "global.h"  // Include global variable definitions
+#include "SIMDKernels.h"
 
 class NarrowFFTProcessor {
 public:
     explicit NarrowFFTProcessor(size_t fftSize = 8192, float calibrationConstant = -115.0f);
     ~NarrowFFTProcessor();
 
-    void startProcessing();
-
-    // Method to push sample data into the input queue
-    bool pushSampleData(const ClientInfo& data);
+    // 48 kS/s baseband samples of the client, runs in the task of the ClientObject
+    // returns true if a new waterfall line (ID 1 and 1024 dB values, every 100 ms) was written into bins1024
+    bool processSamples(const ClientInfo& data, std::array<float, 1025>& bins1024);
 
 private:
     int clientID=0;
@@ -27,18 +25,29 @@ private:
     fftwf_plan fftPlan_ = nullptr;
     fftwf_complex* fftIn_ = nullptr;
     fftwf_complex* fftOut_ = nullptr;
-    std::thread processingThread_;
-    boost::lockfree::spsc_queue<ClientInfo, boost::lockfree::capacity<1024>> narrowInputQueue_;
     std::vector<liquid_float_complex> sampleBuffer;
     std::chrono::steady_clock::time_point lastUpdate_;
-    std::atomic<bool> keepRunning{true};  // Use atomic to ensure thread-safe flag
 
     std::vector<float> downscaleFftBins(const std::vector<float>& bins, size_t targetSize = 1024);
     std::vector<float> rearrangeFftOutput();
-    void fftProcessing();
+};
+
+// small waterfall (+-24 kHz around the tuned frequency) cut out of the full resolution
+// spectrum of the FFTProcessor, costs only a copy and a max-decimation per client
+class NarrowSpectrumSlicer {
+public:
+    NarrowSpectrumSlicer();
+
+    // fullSpectrum: averaged power of the FFT_SIZE bins in fftshift order
+    // shift: tuned frequency relative to the band center in Hz
+    // bins1024: ID (1.0) and the 1024 bins in dB
+    void slice(const std::vector<float>& fullSpectrum, float shift, std::array<float, 1025>& bins1024);
 
-    // Dummy function to process bins1024 array
-    void processBinsOutput(const std::array<float, 1025>& bins1024, int clientID);
+private:
+    const SIMDKernels& kernels;
+    std::vector<float> sliceBuffer;
+    std::vector<unsigned int> binEdges;
+    std::vector<float> displayPower;
 };
 
 #endif // NARROWFFT_PROCESSOR_H
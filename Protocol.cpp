@@ -0,0 +1,108 @@
+#include "Protocol.h"
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <algorithm>
+#include "VirtualBands.h"
+
+// the x86 and ARM hosts are little endian like the wire format, values are copied as they are
+template <typename T>
+static void append(std::string& out, T value) {
+    out.append(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+template <typename T>
+static T read(std::string_view message, size_t pos) {
+    T value;
+    std::memcpy(&value, message.data() + pos, sizeof(T));
+    return value;
+}
+
+static uint32_t timestampMs() {
+    static const auto serverStart = std::chrono::steady_clock::now();
+    auto elapsed = std::chrono::steady_clock::now() - serverStart;
+    return static_cast<uint32_t>(std::chrono::duration_cast<std::chrono::milliseconds>(elapsed).count());
+}
+
+void encodeHeaderV2(uint8_t type, uint8_t flags, uint16_t sequence, std::string& out) {
+    out.clear();
+    append<uint8_t>(out, type);
+    append<uint8_t>(out, flags);
+    append<uint16_t>(out, sequence);
+    append<uint32_t>(out, timestampMs());
+}
+
+void encodeFrameV2(const ClientTXData& txdata, uint8_t flags, uint16_t sequence, std::string& out) {
+    const std::array<float, 1025>& data = txdata.data;
+    uint8_t type = static_cast<uint8_t>(std::lround(data[0]));
+
+    encodeHeaderV2(type, flags, sequence, out);
+
+    switch (type) {
+        case 2: {
+            // configuration, legacy: center, shift, mode, start, end, users, bands
+            append<uint32_t>(out, static_cast<uint32_t>(std::lround(data[1])));
+            append<uint32_t>(out, static_cast<uint32_t>(std::lround(data[4])));
+            append<uint32_t>(out, static_cast<uint32_t>(std::lround(data[5])));
+            append<float>(out, data[2]);
+            append<uint16_t>(out, static_cast<uint16_t>(std::lround(data[6])));
+            append<uint8_t>(out, static_cast<uint8_t>(std::lround(data[3])));
+            append<uint8_t>(out, static_cast<uint8_t>(MAX_VBANDS));
+            for (int i = 0; i < MAX_VBANDS; i++) {
+                append<uint16_t>(out, static_cast<uint16_t>(std::lround(data[7 + i])));
+            }
+            break;
+        }
+        case 4: {
+            // user list, legacy: one character per float, 0 terminated
+            for (size_t i = 1; i < data.size() && data[i] != 0.0f; i++) {
+                out += static_cast<char>(std::lround(data[i]));
+            }
+            break;
+        }
+        case 5:
+            // authentication failed
+            break;
+        default: {
+            // waterfall, audio and compressed waterfall: the payload is used as it is
+            size_t length = std::min<size_t>(txdata.length, data.size() * sizeof(float));
+            if (length > sizeof(float)) {
+                out.append(reinterpret_cast<const char*>(data.data() + 1), length - sizeof(float));
+            }
+            break;
+        }
+    }
+}
+
+bool decodeMessageV2(std::string_view message, std::vector<float>& out) {
+    if (message.size() < PROTOCOL_HEADER_SIZE) return false;
+    uint8_t type = read<uint8_t>(message, 0);
+    size_t payload = message.size() - PROTOCOL_HEADER_SIZE;
+
+    out.clear();
+    out.push_back(type);
+    switch (type) {
+        case 0:
+            if (payload < sizeof(float)) return false;
+            out.push_back(read<float>(message, PROTOCOL_HEADER_SIZE));
+            return true;
+        case 1: case 2: case 3: case 5: case 6: case 7: case 9: case 10:
+            if (payload < sizeof(int32_t)) return false;
+            out.push_back(static_cast<float>(read<int32_t>(message, PROTOCOL_HEADER_SIZE)));
+            return true;
+        case 8:
+            if (payload < 2 * sizeof(float) + sizeof(int32_t)) return false;
+            out.push_back(read<float>(message, PROTOCOL_HEADER_SIZE));
+            out.push_back(read<float>(message, PROTOCOL_HEADER_SIZE + 4));
+            out.push_back(static_cast<float>(read<int32_t>(message, PROTOCOL_HEADER_SIZE + 8)));
+            return true;
+        case 4:
+            // the ClientObject expects one character per float
+            for (size_t i = PROTOCOL_HEADER_SIZE; i < message.size(); i++) {
+                out.push_back(static_cast<uint8_t>(message[i]));
+            }
+            return true;
+        default:
+            return false;
+    }
+}
@@ -0,0 +1,55 @@
+#ifndef PROTOCOL_H
+#define PROTOCOL_H
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <cstdint>
+#include "global.h"
+
+// WebSocket protocol version 2, selected by the browser with the subprotocol PROTOCOL_V2_NAME
+// (new WebSocket(url, "kwsdr.v2")), all other connections get the legacy frames:
+// 1025 floats, the ID in the first float (shorter for audio and compressed waterfall lines)
+//
+// every v2 frame (both directions) starts with an 8 byte header, little endian:
+//   0  uint8   type, same numbers as the legacy IDs
+//   1  uint8   flags: bit 0 = published to a topic (sequence counts the topic, not the connection)
+//   2  uint16  sequence number, +1 per frame
+//   4  uint32  timestamp: ms since the server start (browser: 0)
+// followed by exactly the payload, no padding:
+//
+// server -> browser
+//   0, 1   waterfall: 1024 float32 dB values (ID 0 of a spectrum window: its width)
+//   2      configuration: uint32 center Hz, uint32 start Hz, uint32 end Hz, float32 shift Hz,
+//          uint16 users, uint8 mode, uint8 number of bands, uint16 band per band
+//   3      audio float32 samples
+//   4      user list: UTF-8 text, names separated by ','
+//   5      authentication failed: no payload
+//   6...8  audio int16 / mu-law / ADPCM: the bytes after the ID of the legacy frame (see AudioCodec.h)
+//   9      compressed waterfall: the bytes after the ID of the legacy frame (see WaterfallCodec.h)
+//   10     carrier list: float32 number of carriers, then per carrier float32 frequency (Hz above the band start),
+//          bandwidth (Hz) and SNR (dB), like the legacy frame
+//
+// browser -> server
+//   0      frequency offset: float32 Hz
+//   1...3  band, mode, filter: int32
+//   4      user and password: UTF-8 text "user:password"
+//   5...7  audio frame size, audio format, waterfall format: int32
+//   8      spectrum window: float32 start, float32 span (Hz above the band start, span 0 = whole band), int32 width
+//   9      carrier list (ID 10) on/off: int32
+//   10     waterfall history on/off: int32, the last lines of the band after connecting (compressed format only)
+const char* const PROTOCOL_V2_NAME = "kwsdr.v2";
+const unsigned int PROTOCOL_HEADER_SIZE = 8;
+const uint8_t PROTOCOL_FLAG_PUBLISHED = 1;
+
+// v2 header, written into out, the payload is appended by the caller
+void encodeHeaderV2(uint8_t type, uint8_t flags, uint16_t sequence, std::string& out);
+
+// v2 frame of a message in the legacy layout (txdata.data[0] = ID), written into out
+void encodeFrameV2(const ClientTXData& txdata, uint8_t flags, uint16_t sequence, std::string& out);
+
+// v2 browser message into the legacy float layout (message[0] = ID) which the ClientObject expects
+// returns false if the message is invalid
+bool decodeMessageV2(std::string_view message, std::vector<float>& out);
+
+#endif // PROTOCOL_H
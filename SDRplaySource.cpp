@@ -0,0 +1,118 @@
+#include <stdio.h>
+#include <iostream>
+#include "SDRplaySource.h"
+#include "IngestProcessor.h"
+#include "sdrplay_api.h" // the SDRplay driver must be installed!
+
+// Constructor
+SDRplaySource::SDRplaySource() : numDevs(0), deviceParams(nullptr), chParams(nullptr), err(sdrplay_api_Success), chosenDevice(nullptr) {
+}
+
+// Destructor (cleans up the API)
+SDRplaySource::~SDRplaySource() {
+/*    if (chosenDevice) {
+        sdrplay_api_Uninit(chosenDevice->dev);
+        sdrplay_api_ReleaseDevice(chosenDevice);
+    }
+    sdrplay_api_Close();*/
+}
+
+// Initializes the SDR hardware
+bool SDRplaySource::init(uint32_t frequency) {
+    printf("Initialize SDRplay hardware\n");
+
+    // Öffne die SDRplay API
+    if ((err = sdrplay_api_Open()) != sdrplay_api_Success) {
+        printf("sdrplay_api_Open failed: %s\n", sdrplay_api_GetErrorString(err));
+        return false;
+    }
+
+    printf("SDRplay API opened\n");
+
+    // Geräte scannen
+    sdrplay_api_GetDevices(devices, &numDevs, sizeof(devices) / sizeof(sdrplay_api_DeviceT));
+
+    // Überprüfen, ob ein Gerät verfügbar ist
+    if (numDevs == 0) {
+        printf("ERROR: No RSP devices available.\n");
+        return false;
+    }
+    printf("%d devices detected. devices[0].hwVer = %d\n",numDevs,devices[0].hwVer);
+
+    // Wähle das erste verfügbare Gerät (RSP1A oder RSP1B)
+    if (devices[0].hwVer == SDRPLAY_RSP1A_ID) {
+        chosenDevice = &devices[0];
+        printf("SDRPLAY_RSP1A_ID found\n");
+    } 
+    else if (devices[0].hwVer == SDRPLAY_RSP1B_ID) {
+        chosenDevice = &devices[0];
+        printf("SDRPLAY_RSP1B_ID found\n");
+    } else {
+        printf("ERROR: RSP selected is not available.\n");
+        return false;
+    }
+
+    // Gerät zur Nutzung auswählen
+    sdrplay_api_SelectDevice(chosenDevice);
+    printf("device selected\n");
+
+    // Hole die Geräteparameter
+    sdrplay_api_GetDeviceParams(chosenDevice->dev, &deviceParams);
+    printf("device parameters read\n");
+
+    // Setze die Tunerparameter
+    printf("set tuner parameters\n");
+    chParams = deviceParams->rxChannelA;
+    deviceParams->rxChannelA->tunerParams.gain.gRdB = 20;        // Example: 40 dB gain reduction
+    deviceParams->rxChannelA->tunerParams.gain.LNAstate = 1;     // Example: LNA state
+    deviceParams->rxChannelA->tunerParams.gain.syncUpdate = 0;   // Default: no sync update needed
+    deviceParams->rxChannelA->tunerParams.gain.minGr = sdrplay_api_NORMAL_MIN_GR; // Normal gain reduction
+    chParams->tunerParams.rfFreq.rfHz = frequency;
+    chParams->tunerParams.bwType = sdrplay_api_BW_1_536; // 1.536 MHz: room for the virtual bands
+    deviceParams->rxChannelA->tunerParams.ifType = sdrplay_api_IF_Zero; // output is in baseband
+    deviceParams->devParams->fsFreq.fsHz = 2400000.0;  // sample rate 2.4 MS/s
+    deviceParams->rxChannelA->ctrlParams.agc.enable = sdrplay_api_AGC_100HZ;
+    deviceParams->rxChannelA->ctrlParams.agc.setPoint_dBfs = -30;
+
+    // Callbacks einrichten
+    sdrplay_api_CallbackFnsT cbFns;
+    cbFns.StreamACbFn = StreamACallback;
+    cbFns.EventCbFn = EventCallback;
+
+    // Gerät initialisieren und Stream starten
+    if ((err = sdrplay_api_Init(chosenDevice->dev, &cbFns, NULL)) != sdrplay_api_Success) {
+        printf("sdrplay_api_Init failed: %s\n", sdrplay_api_GetErrorString(err));
+        return false;
+    }
+
+    return true;
+}
+
+// runs in the SDRplay driver thread
+// only copies the raw samples, all processing is done in the IngestProcessor thread
+void SDRplaySource::StreamACallback(short *xi, short *xq, sdrplay_api_StreamCbParamsT *params, unsigned int numSamples, unsigned int reset, void *cbContext) {
+    IngestProcessor::getInstance().pushRawSamples(xi, xq, numSamples, reset);
+}
+
+// Event callback function (static member function)
+void SDRplaySource::EventCallback(sdrplay_api_EventT eventId, sdrplay_api_TunerSelectT tuner, sdrplay_api_EventParamsT *params, void *cbContext) {
+    if (eventId == sdrplay_api_GainChange) {
+        /*
+        // set LNAstate to keep this gRdB between 20 and 59)
+        printf("Baseband Gain Reduction (gRdB): %d\n", params->gainParams.gRdB);
+        printf("LNA Gain Reduction (lnaGRdB): %d\n", params->gainParams.lnaGRdB);
+        printf("Current Total Gain: %.2f dB\n", params->gainParams.currGain);
+        */
+    }
+}
+
+void SDRplaySource::setFrequency(uint32_t frequency) {
+    deviceParams->rxChannelA->tunerParams.rfFreq.rfHz = (double)frequency;
+
+    // Call sdrplay_api_Update to apply the new frequency
+    sdrplay_api_ErrT ret = sdrplay_api_Update(chosenDevice->dev, sdrplay_api_Tuner_A, sdrplay_api_Update_Tuner_Frf, sdrplay_api_Update_Ext1_None);
+
+    if (ret != sdrplay_api_Success) {
+        printf("Error: sdrplay_api_Update failed with code %d: %s\n", ret, sdrplay_api_GetErrorString(ret));
+    }
+}
@@ -0,0 +1,29 @@
+#ifndef SDRPLAY_SOURCE_H
+#define SDRPLAY_SOURCE_H
+
+#include "IQSource.h"
+#include "sdrplay_api.h"      // Needed for the API types in the class declaration
+
+// IQ source for the SDRplay RSP1A and RSP1B
+class SDRplaySource : public IQSource {
+public:
+    SDRplaySource();
+    ~SDRplaySource() override;
+
+    bool init(uint32_t frequency) override;
+    void setFrequency(uint32_t frequency) override;
+    const char* getName() const override { return "SDRplay RSP1A/RSP1B"; }
+
+private:
+    static void StreamACallback(short *xi, short *xq, sdrplay_api_StreamCbParamsT *params, unsigned int numSamples, unsigned int reset, void *cbContext);
+    static void EventCallback(sdrplay_api_EventT eventId, sdrplay_api_TunerSelectT tuner, sdrplay_api_EventParamsT *params, void *cbContext);
+
+    sdrplay_api_DeviceT devices[4];
+    unsigned int numDevs;
+    sdrplay_api_DeviceParamsT *deviceParams;
+    sdrplay_api_RxChannelParamsT *chParams;
+    sdrplay_api_ErrT err;
+    sdrplay_api_DeviceT *chosenDevice;
+};
+
+#endif // SDRPLAY_SOURCE_H
@@ -0,0 +1,173 @@
+#include "SIMDKernels.h"
+#include <stdio.h>
+#include <cstring>
+#include <cstdint>
+#include <cmath>
+#if defined(__arm__) && !defined(__aarch64__)
+#include <sys/auxv.h>
+#include <asm/hwcap.h>
+#endif
+
+// ===== scalar reference kernels =====
+
+static void convertInt16_scalar(const short *xi, const short *xq, size_t n, float scale,
+                                float dcI, float dcQ, float *outI, float *outQ, float *sumI, float *sumQ) {
+    float si = 0.0f, sq = 0.0f;
+    for (size_t i = 0; i < n; i++) {
+        float vi = xi[i] * scale;
+        float vq = xq[i] * scale;
+        si += vi;
+        sq += vq;
+        outI[i] = vi - dcI;
+        outQ[i] = vq - dcQ;
+    }
+    *sumI = si;
+    *sumQ = sq;
+}
+
+static void firDecimate_scalar(const float *xI, const float *xQ, const float *taps, size_t numTaps,
+                               size_t numOut, size_t decim, float *out) {
+    for (size_t m = 0; m < numOut; m++) {
+        const float *pI = xI + m * decim;
+        const float *pQ = xQ + m * decim;
+        float accI = 0.0f, accQ = 0.0f;
+        for (size_t k = 0; k < numTaps; k++) {
+            accI += taps[k] * pI[k];
+            accQ += taps[k] * pQ[k];
+        }
+        out[2 * m] = accI;
+        out[2 * m + 1] = accQ;
+    }
+}
+
+static void mixPlanar_scalar(float *xI, float *xQ, const float *cosTab, const float *sinTab, size_t n) {
+    for (size_t i = 0; i < n; i++) {
+        float vi = xI[i] * cosTab[i] - xQ[i] * sinTab[i];
+        float vq = xI[i] * sinTab[i] + xQ[i] * cosTab[i];
+        xI[i] = vi;
+        xQ[i] = vq;
+    }
+}
+
+static void powerAccumulate_scalar(const float *x, float *acc, size_t n) {
+    for (size_t i = 0; i < n; i++) {
+        acc[i] += x[2 * i] * x[2 * i] + x[2 * i + 1] * x[2 * i + 1];
+    }
+}
+
+static void maxDecimate_scalar(const float *in, const unsigned int *edges, size_t numOut, float *out) {
+    for (size_t i = 0; i < numOut; i++) {
+        float m = in[edges[i]];
+        for (unsigned int k = edges[i] + 1; k < edges[i + 1]; k++) {
+            if (in[k] > m) m = in[k];
+        }
+        out[i] = m;
+    }
+}
+
+static void powerToDb_scalar(const float *in, size_t n, float scale, float offset, float *out) {
+    const float f = scale * LOG10_2;
+    for (size_t i = 0; i < n; i++) {
+        // split into exponent and mantissa 1...2
+        float v = in[i] > POWER_MIN ? in[i] : POWER_MIN;
+        uint32_t bits;
+        std::memcpy(&bits, &v, sizeof(bits));
+        float e = static_cast<float>(static_cast<int>(bits >> 23) - 127);
+        bits = (bits & 0x007FFFFF) | 0x3F800000;
+        float m;
+        std::memcpy(&m, &bits, sizeof(m));
+        float u = m - 1.5f;
+        float log2v = e + LOG2_POLY_C0 + u * (LOG2_POLY_C1 + u * (LOG2_POLY_C2 + u * LOG2_POLY_C3));
+        out[i] = log2v * f + offset;
+    }
+}
+
+static float peakAbs_scalar(const float *x, size_t n) {
+    float m = 0.0f;
+    for (size_t i = 0; i < n; i++) {
+        float v = std::fabs(x[i]);
+        if (v > m) m = v;
+    }
+    return m;
+}
+
+static void gainRamp_scalar(float *x, size_t n, float gain, float step, float clip) {
+    for (size_t i = 0; i < n; i++) {
+        float v = x[i] * (gain + static_cast<float>(i) * step);
+        x[i] = v > clip ? clip : (v < -clip ? -clip : v);
+    }
+}
+
+static inline int audioToInt(float x) {
+    float v = x * 32767.0f;
+    v = v > 32767.0f ? 32767.0f : (v < -32768.0f ? -32768.0f : v);
+    return static_cast<int>(std::lrint(v));
+}
+
+static void floatToInt16_scalar(const float *in, size_t n, int16_t *out) {
+    for (size_t i = 0; i < n; i++) {
+        out[i] = static_cast<int16_t>(audioToInt(in[i]));
+    }
+}
+
+static void floatToMuLaw_scalar(const float *in, size_t n, uint8_t *out) {
+    for (size_t i = 0; i < n; i++) {
+        int v = audioToInt(in[i]);
+        int sign = v < 0 ? 0x80 : 0;
+        int mag = v < 0 ? -v : v;
+        if (mag > MULAW_CLIP) mag = MULAW_CLIP;
+        mag += MULAW_BIAS;
+
+        // segment = position of the highest bit - 7 (mag >= 132, so 0...7)
+        int exponent = 31 - __builtin_clz(static_cast<unsigned int>(mag)) - 7;
+        int mantissa = (mag >> (exponent + 3)) & 0x0F;
+        out[i] = static_cast<uint8_t>(~(sign | (exponent << 4) | mantissa));
+    }
+}
+
+static const SIMDKernels scalarKernels = {
+    "scalar",
+    convertInt16_scalar,
+    firDecimate_scalar,
+    mixPlanar_scalar,
+    powerAccumulate_scalar,
+    maxDecimate_scalar,
+    powerToDb_scalar,
+    peakAbs_scalar,
+    gainRamp_scalar,
+    floatToInt16_scalar,
+    floatToMuLaw_scalar
+};
+
+const SIMDKernels& getScalarKernels() {
+    return scalarKernels;
+}
+
+// ===== runtime dispatch =====
+
+static const SIMDKernels& selectSIMDKernels() {
+    const SIMDKernels* k = nullptr;
+
+#if defined(__x86_64__)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) {
+        k = getAVX2Kernels();
+    }
+#elif defined(__aarch64__)
+    // NEON is mandatory on aarch64
+    k = getNEONKernels();
+#elif defined(__arm__)
+    if (getauxval(AT_HWCAP) & HWCAP_NEON) {
+        k = getNEONKernels();
+    }
+#endif
+
+    if (!k) k = &scalarKernels;
+    printf("using %s DSP kernels\n", k->name);
+    return *k;
+}
+
+const SIMDKernels& getSIMDKernels() {
+    static const SIMDKernels& kernels = selectSIMDKernels();
+    return kernels;
+}
@@ -0,0 +1,86 @@
+#ifndef SIMD_KERNELS_H
+#define SIMD_KERNELS_H
+
+#include <cstddef>
+#include <cstdint>
+
+// Vectorized DSP kernels
+// every kernel has a scalar reference version and, depending on the architecture,
+// an AVX2 (x86_64) or NEON (aarch64, armhf) version. The fastest version supported
+// by the CPU is selected once at runtime, see selectSIMDKernels()
+
+// int16 I/Q to float with DC removal
+// out = in * scale - dc, the sums of the unmodified (scaled) input are returned for the DC estimation
+typedef void (*ConvertInt16Kernel)(const short *xi, const short *xq, size_t n, float scale,
+                                   float dcI, float dcQ, float *outI, float *outQ, float *sumI, float *sumQ);
+
+// FIR filter and decimation of planar I/Q data into interleaved complex output
+// output m is the dot product of taps[0..numTaps-1] and x[m*decim .. m*decim+numTaps-1]
+// numTaps must be a multiple of 8, the taps are stored in reversed order
+typedef void (*FirDecimateKernel)(const float *xI, const float *xQ, const float *taps, size_t numTaps,
+                                  size_t numOut, size_t decim, float *out);
+
+// frequency shift of planar I/Q data in place: x[i] *= (cosTab[i] + j*sinTab[i])
+typedef void (*MixPlanarKernel)(float *xI, float *xQ, const float *cosTab, const float *sinTab, size_t n);
+
+// power |x|^2 of n interleaved complex values, added to acc (Welch average)
+typedef void (*PowerAccumulateKernel)(const float *x, float *acc, size_t n);
+
+// maximum of in[edges[i] .. edges[i+1]-1] for every output i, every range must contain at least one value
+typedef void (*MaxDecimateKernel)(const float *in, const unsigned int *edges, size_t numOut, float *out);
+
+// out = scale * log10(in) + offset with a fast log approximation (error < 0.01 dB for scale = 10)
+typedef void (*PowerToDbKernel)(const float *in, size_t n, float scale, float offset, float *out);
+
+// maximum of |x[i]|, 0 for n = 0 (AGC level detection)
+typedef float (*PeakAbsKernel)(const float *x, size_t n);
+
+// x[i] *= gain + i * step, then clipped to -clip...clip (AGC gain ramp)
+typedef void (*GainRampKernel)(float *x, size_t n, float gain, float step, float clip);
+
+// audio -1...1 to rounded int16 (x * 32767), saturated
+typedef void (*FloatToInt16Kernel)(const float *in, size_t n, int16_t *out);
+
+// audio -1...1 to G.711 mu-law bytes (via the same int16 values as floatToInt16)
+typedef void (*FloatToMuLawKernel)(const float *in, size_t n, uint8_t *out);
+
+struct SIMDKernels {
+    const char *name;
+    ConvertInt16Kernel convertInt16;
+    FirDecimateKernel firDecimate;
+    MixPlanarKernel mixPlanar;
+    PowerAccumulateKernel powerAccumulate;
+    MaxDecimateKernel maxDecimate;
+    PowerToDbKernel powerToDb;
+    PeakAbsKernel peakAbs;
+    GainRampKernel gainRamp;
+    FloatToInt16Kernel floatToInt16;
+    FloatToMuLawKernel floatToMuLaw;
+};
+
+// polynomial for log2(m), m = 1...2, in u = m - 1.5 (used by all powerToDb kernels)
+const float LOG2_POLY_C0 = 0.58537874f;
+const float LOG2_POLY_C1 = 0.96116786f;
+const float LOG2_POLY_C2 = -0.33688879f;
+const float LOG2_POLY_C3 = 0.15391848f;
+const float LOG10_2 = 0.30103000f;
+const float POWER_MIN = 1e-30f;     // avoids log(0)
+
+// mu-law: magnitudes are limited to MULAW_CLIP, then MULAW_BIAS is added
+const int MULAW_CLIP = 32635;
+const int MULAW_BIAS = 132;
+
+// returns the kernels for the current CPU, selected on the first call
+const SIMDKernels& getSIMDKernels();
+
+// the plain C++ versions, always available (also used as reference)
+const SIMDKernels& getScalarKernels();
+
+#if defined(__x86_64__)
+const SIMDKernels* getAVX2Kernels();    // nullptr if not compiled in
+#endif
+#if defined(__aarch64__) || defined(__arm__)
+const SIMDKernels* getNEONKernels();    // nullptr if not compiled in
+#endif
+
+#endif // SIMD_KERNELS_H
@@ -0,0 +1,263 @@
+// AVX2/FMA versions of the DSP kernels
+// this file is compiled with -mavx2 -mfma (see Makefile), the kernels
+// are only called if the CPU supports these instruction sets
+#include "SIMDKernels.h"
+
+#if defined(__x86_64__)
+
+#if defined(__AVX2__) && defined(__FMA__)
+#include <immintrin.h>
+
+static inline float hsum256(__m256 v) {
+    __m128 lo = _mm256_castps256_ps128(v);
+    __m128 hi = _mm256_extractf128_ps(v, 1);
+    lo = _mm_add_ps(lo, hi);
+    __m128 shuf = _mm_movehdup_ps(lo);
+    __m128 sums = _mm_add_ps(lo, shuf);
+    shuf = _mm_movehl_ps(shuf, sums);
+    sums = _mm_add_ss(sums, shuf);
+    return _mm_cvtss_f32(sums);
+}
+
+static void convertInt16_avx2(const short *xi, const short *xq, size_t n, float scale,
+                              float dcI, float dcQ, float *outI, float *outQ, float *sumI, float *sumQ) {
+    const __m256 vscale = _mm256_set1_ps(scale);
+    const __m256 vdcI = _mm256_set1_ps(dcI);
+    const __m256 vdcQ = _mm256_set1_ps(dcQ);
+    __m256 accI = _mm256_setzero_ps();
+    __m256 accQ = _mm256_setzero_ps();
+
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m128i si = _mm_loadu_si128(reinterpret_cast<const __m128i*>(xi + i));
+        __m128i sq = _mm_loadu_si128(reinterpret_cast<const __m128i*>(xq + i));
+        __m256 vi = _mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_cvtepi16_epi32(si)), vscale);
+        __m256 vq = _mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_cvtepi16_epi32(sq)), vscale);
+        accI = _mm256_add_ps(accI, vi);
+        accQ = _mm256_add_ps(accQ, vq);
+        _mm256_storeu_ps(outI + i, _mm256_sub_ps(vi, vdcI));
+        _mm256_storeu_ps(outQ + i, _mm256_sub_ps(vq, vdcQ));
+    }
+
+    float si = hsum256(accI), sq = hsum256(accQ);
+    for (; i < n; i++) {
+        float vi = xi[i] * scale;
+        float vq = xq[i] * scale;
+        si += vi;
+        sq += vq;
+        outI[i] = vi - dcI;
+        outQ[i] = vq - dcQ;
+    }
+    *sumI = si;
+    *sumQ = sq;
+}
+
+static void firDecimate_avx2(const float *xI, const float *xQ, const float *taps, size_t numTaps,
+                             size_t numOut, size_t decim, float *out) {
+    for (size_t m = 0; m < numOut; m++) {
+        const float *pI = xI + m * decim;
+        const float *pQ = xQ + m * decim;
+        __m256 accI = _mm256_setzero_ps();
+        __m256 accQ = _mm256_setzero_ps();
+        for (size_t k = 0; k < numTaps; k += 8) {
+            __m256 h = _mm256_loadu_ps(taps + k);
+            accI = _mm256_fmadd_ps(h, _mm256_loadu_ps(pI + k), accI);
+            accQ = _mm256_fmadd_ps(h, _mm256_loadu_ps(pQ + k), accQ);
+        }
+        out[2 * m] = hsum256(accI);
+        out[2 * m + 1] = hsum256(accQ);
+    }
+}
+
+static void mixPlanar_avx2(float *xI, float *xQ, const float *cosTab, const float *sinTab, size_t n) {
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256 vi = _mm256_loadu_ps(xI + i);
+        __m256 vq = _mm256_loadu_ps(xQ + i);
+        __m256 c = _mm256_loadu_ps(cosTab + i);
+        __m256 s = _mm256_loadu_ps(sinTab + i);
+        _mm256_storeu_ps(xI + i, _mm256_fmsub_ps(vi, c, _mm256_mul_ps(vq, s)));
+        _mm256_storeu_ps(xQ + i, _mm256_fmadd_ps(vi, s, _mm256_mul_ps(vq, c)));
+    }
+    for (; i < n; i++) {
+        float vi = xI[i] * cosTab[i] - xQ[i] * sinTab[i];
+        float vq = xI[i] * sinTab[i] + xQ[i] * cosTab[i];
+        xI[i] = vi;
+        xQ[i] = vq;
+    }
+}
+
+static void powerAccumulate_avx2(const float *x, float *acc, size_t n) {
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256 a = _mm256_loadu_ps(x + 2 * i);
+        __m256 b = _mm256_loadu_ps(x + 2 * i + 8);
+        // re^2 + im^2, hadd leaves the values in the order 0 1 4 5 2 3 6 7
+        __m256 p = _mm256_hadd_ps(_mm256_mul_ps(a, a), _mm256_mul_ps(b, b));
+        p = _mm256_castpd_ps(_mm256_permute4x64_pd(_mm256_castps_pd(p), 0xD8));
+        _mm256_storeu_ps(acc + i, _mm256_add_ps(_mm256_loadu_ps(acc + i), p));
+    }
+    for (; i < n; i++) {
+        acc[i] += x[2 * i] * x[2 * i] + x[2 * i + 1] * x[2 * i + 1];
+    }
+}
+
+static inline float hmax256(__m256 v) {
+    __m128 m = _mm_max_ps(_mm256_castps256_ps128(v), _mm256_extractf128_ps(v, 1));
+    m = _mm_max_ps(m, _mm_movehl_ps(m, m));
+    m = _mm_max_ss(m, _mm_movehdup_ps(m));
+    return _mm_cvtss_f32(m);
+}
+
+static void maxDecimate_avx2(const float *in, const unsigned int *edges, size_t numOut, float *out) {
+    for (size_t i = 0; i < numOut; i++) {
+        unsigned int k = edges[i];
+        const unsigned int end = edges[i + 1];
+        float m = in[k];
+        if (end - k >= 8) {
+            __m256 vm = _mm256_loadu_ps(in + k);
+            for (k += 8; k + 8 <= end; k += 8) {
+                vm = _mm256_max_ps(vm, _mm256_loadu_ps(in + k));
+            }
+            m = hmax256(vm);
+        }
+        for (; k < end; k++) {
+            if (in[k] > m) m = in[k];
+        }
+        out[i] = m;
+    }
+}
+
+static void powerToDb_avx2(const float *in, size_t n, float scale, float offset, float *out) {
+    const __m256 vf = _mm256_set1_ps(scale * LOG10_2);
+    const __m256 voffset = _mm256_set1_ps(offset);
+    const __m256 vmin = _mm256_set1_ps(POWER_MIN);
+    const __m256i mantMask = _mm256_set1_epi32(0x007FFFFF);
+    const __m256i one = _mm256_set1_epi32(0x3F800000);
+    const __m256i bias = _mm256_set1_epi32(127);
+    const __m256 c0 = _mm256_set1_ps(LOG2_POLY_C0), c1 = _mm256_set1_ps(LOG2_POLY_C1);
+    const __m256 c2 = _mm256_set1_ps(LOG2_POLY_C2), c3 = _mm256_set1_ps(LOG2_POLY_C3);
+    const __m256 half3 = _mm256_set1_ps(1.5f);
+
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256i bits = _mm256_castps_si256(_mm256_max_ps(_mm256_loadu_ps(in + i), vmin));
+        __m256 e = _mm256_cvtepi32_ps(_mm256_sub_epi32(_mm256_srli_epi32(bits, 23), bias));
+        __m256 u = _mm256_sub_ps(_mm256_castsi256_ps(_mm256_or_si256(_mm256_and_si256(bits, mantMask), one)), half3);
+        __m256 p = _mm256_fmadd_ps(u, c3, c2);
+        p = _mm256_fmadd_ps(u, p, c1);
+        p = _mm256_fmadd_ps(u, p, c0);
+        _mm256_storeu_ps(out + i, _mm256_fmadd_ps(_mm256_add_ps(e, p), vf, voffset));
+    }
+    if (i < n) {
+        getScalarKernels().powerToDb(in + i, n - i, scale, offset, out + i);
+    }
+}
+
+static float peakAbs_avx2(const float *x, size_t n) {
+    const __m256 absMask = _mm256_castsi256_ps(_mm256_set1_epi32(0x7FFFFFFF));
+    __m256 vm = _mm256_setzero_ps();
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        vm = _mm256_max_ps(vm, _mm256_and_ps(_mm256_loadu_ps(x + i), absMask));
+    }
+    float m = hmax256(vm);
+    if (i < n) {
+        float t = getScalarKernels().peakAbs(x + i, n - i);
+        if (t > m) m = t;
+    }
+    return m;
+}
+
+static void gainRamp_avx2(float *x, size_t n, float gain, float step, float clip) {
+    const __m256 vstep8 = _mm256_set1_ps(8.0f * step);
+    const __m256 vclip = _mm256_set1_ps(clip);
+    const __m256 vnclip = _mm256_set1_ps(-clip);
+    __m256 vg = _mm256_fmadd_ps(_mm256_setr_ps(0, 1, 2, 3, 4, 5, 6, 7), _mm256_set1_ps(step), _mm256_set1_ps(gain));
+
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256 v = _mm256_mul_ps(_mm256_loadu_ps(x + i), vg);
+        _mm256_storeu_ps(x + i, _mm256_max_ps(_mm256_min_ps(v, vclip), vnclip));
+        vg = _mm256_add_ps(vg, vstep8);
+    }
+    if (i < n) {
+        getScalarKernels().gainRamp(x + i, n - i, gain + static_cast<float>(i) * step, step, clip);
+    }
+}
+
+// rounded int32 of x * 32767, limited to the int16 range
+static inline __m256i audioToInt_avx2(__m256 x) {
+    __m256 v = _mm256_mul_ps(x, _mm256_set1_ps(32767.0f));
+    v = _mm256_max_ps(_mm256_min_ps(v, _mm256_set1_ps(32767.0f)), _mm256_set1_ps(-32768.0f));
+    return _mm256_cvtps_epi32(v);
+}
+
+static void floatToInt16_avx2(const float *in, size_t n, int16_t *out) {
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256i v = audioToInt_avx2(_mm256_loadu_ps(in + i));
+        __m128i p = _mm_packs_epi32(_mm256_castsi256_si128(v), _mm256_extracti128_si256(v, 1));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), p);
+    }
+    if (i < n) {
+        getScalarKernels().floatToInt16(in + i, n - i, out + i);
+    }
+}
+
+static void floatToMuLaw_avx2(const float *in, size_t n, uint8_t *out) {
+    const __m256i clip = _mm256_set1_epi32(MULAW_CLIP);
+    const __m256i bias = _mm256_set1_epi32(MULAW_BIAS);
+    const __m256i mask4 = _mm256_set1_epi32(0x0F);
+    const __m256i three = _mm256_set1_epi32(3);
+    const __m256i exp0 = _mm256_set1_epi32(127 + 7);
+    const __m256i ones = _mm256_set1_epi32(0xFF);
+
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256i v = audioToInt_avx2(_mm256_loadu_ps(in + i));
+        __m256i sign = _mm256_and_si256(_mm256_srai_epi32(v, 31), _mm256_set1_epi32(0x80));
+        __m256i mag = _mm256_add_epi32(_mm256_min_epi32(_mm256_abs_epi32(v), clip), bias);
+
+        // highest bit from the float exponent (mag is exactly representable)
+        __m256i e = _mm256_srli_epi32(_mm256_castps_si256(_mm256_cvtepi32_ps(mag)), 23);
+        __m256i exponent = _mm256_sub_epi32(e, exp0);
+        __m256i mantissa = _mm256_and_si256(_mm256_srlv_epi32(mag, _mm256_add_epi32(exponent, three)), mask4);
+
+        __m256i code = _mm256_or_si256(_mm256_or_si256(sign, _mm256_slli_epi32(exponent, 4)), mantissa);
+        code = _mm256_xor_si256(code, ones);
+
+        __m128i p16 = _mm_packus_epi32(_mm256_castsi256_si128(code), _mm256_extracti128_si256(code, 1));
+        _mm_storel_epi64(reinterpret_cast<__m128i*>(out + i), _mm_packus_epi16(p16, p16));
+    }
+    if (i < n) {
+        getScalarKernels().floatToMuLaw(in + i, n - i, out + i);
+    }
+}
+
+static const SIMDKernels avx2Kernels = {
+    "AVX2",
+    convertInt16_avx2,
+    firDecimate_avx2,
+    mixPlanar_avx2,
+    powerAccumulate_avx2,
+    maxDecimate_avx2,
+    powerToDb_avx2,
+    peakAbs_avx2,
+    gainRamp_avx2,
+    floatToInt16_avx2,
+    floatToMuLaw_avx2
+};
+
+const SIMDKernels* getAVX2Kernels() {
+    return &avx2Kernels;
+}
+
+#else
+
+const SIMDKernels* getAVX2Kernels() {
+    return nullptr;
+}
+
+#endif // __AVX2__
+#endif // __x86_64__
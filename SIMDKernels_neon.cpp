@@ -0,0 +1,276 @@
+// NEON versions of the DSP kernels
+// always available on aarch64, on armhf this file is compiled with -mfpu=neon (see Makefile)
+// and the kernels are only called if the CPU reports NEON support
+#include "SIMDKernels.h"
+
+#if defined(__aarch64__) || defined(__arm__)
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+
+static inline float hsum128(float32x4_t v) {
+#if defined(__aarch64__)
+    return vaddvq_f32(v);
+#else
+    float32x2_t s = vadd_f32(vget_low_f32(v), vget_high_f32(v));
+    s = vpadd_f32(s, s);
+    return vget_lane_f32(s, 0);
+#endif
+}
+
+static void convertInt16_neon(const short *xi, const short *xq, size_t n, float scale,
+                              float dcI, float dcQ, float *outI, float *outQ, float *sumI, float *sumQ) {
+    const float32x4_t vdcI = vdupq_n_f32(dcI);
+    const float32x4_t vdcQ = vdupq_n_f32(dcQ);
+    float32x4_t accI = vdupq_n_f32(0.0f);
+    float32x4_t accQ = vdupq_n_f32(0.0f);
+
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        int16x8_t si = vld1q_s16(xi + i);
+        int16x8_t sq = vld1q_s16(xq + i);
+
+        float32x4_t i0 = vmulq_n_f32(vcvtq_f32_s32(vmovl_s16(vget_low_s16(si))), scale);
+        float32x4_t i1 = vmulq_n_f32(vcvtq_f32_s32(vmovl_s16(vget_high_s16(si))), scale);
+        float32x4_t q0 = vmulq_n_f32(vcvtq_f32_s32(vmovl_s16(vget_low_s16(sq))), scale);
+        float32x4_t q1 = vmulq_n_f32(vcvtq_f32_s32(vmovl_s16(vget_high_s16(sq))), scale);
+
+        accI = vaddq_f32(accI, vaddq_f32(i0, i1));
+        accQ = vaddq_f32(accQ, vaddq_f32(q0, q1));
+
+        vst1q_f32(outI + i, vsubq_f32(i0, vdcI));
+        vst1q_f32(outI + i + 4, vsubq_f32(i1, vdcI));
+        vst1q_f32(outQ + i, vsubq_f32(q0, vdcQ));
+        vst1q_f32(outQ + i + 4, vsubq_f32(q1, vdcQ));
+    }
+
+    float si = hsum128(accI), sq = hsum128(accQ);
+    for (; i < n; i++) {
+        float vi = xi[i] * scale;
+        float vq = xq[i] * scale;
+        si += vi;
+        sq += vq;
+        outI[i] = vi - dcI;
+        outQ[i] = vq - dcQ;
+    }
+    *sumI = si;
+    *sumQ = sq;
+}
+
+static void firDecimate_neon(const float *xI, const float *xQ, const float *taps, size_t numTaps,
+                             size_t numOut, size_t decim, float *out) {
+    for (size_t m = 0; m < numOut; m++) {
+        const float *pI = xI + m * decim;
+        const float *pQ = xQ + m * decim;
+        float32x4_t accI0 = vdupq_n_f32(0.0f), accI1 = vdupq_n_f32(0.0f);
+        float32x4_t accQ0 = vdupq_n_f32(0.0f), accQ1 = vdupq_n_f32(0.0f);
+        for (size_t k = 0; k < numTaps; k += 8) {
+            float32x4_t h0 = vld1q_f32(taps + k);
+            float32x4_t h1 = vld1q_f32(taps + k + 4);
+            accI0 = vmlaq_f32(accI0, h0, vld1q_f32(pI + k));
+            accI1 = vmlaq_f32(accI1, h1, vld1q_f32(pI + k + 4));
+            accQ0 = vmlaq_f32(accQ0, h0, vld1q_f32(pQ + k));
+            accQ1 = vmlaq_f32(accQ1, h1, vld1q_f32(pQ + k + 4));
+        }
+        out[2 * m] = hsum128(vaddq_f32(accI0, accI1));
+        out[2 * m + 1] = hsum128(vaddq_f32(accQ0, accQ1));
+    }
+}
+
+static void mixPlanar_neon(float *xI, float *xQ, const float *cosTab, const float *sinTab, size_t n) {
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        float32x4_t vi = vld1q_f32(xI + i);
+        float32x4_t vq = vld1q_f32(xQ + i);
+        float32x4_t c = vld1q_f32(cosTab + i);
+        float32x4_t s = vld1q_f32(sinTab + i);
+        vst1q_f32(xI + i, vmlsq_f32(vmulq_f32(vi, c), vq, s));
+        vst1q_f32(xQ + i, vmlaq_f32(vmulq_f32(vq, c), vi, s));
+    }
+    for (; i < n; i++) {
+        float vi = xI[i] * cosTab[i] - xQ[i] * sinTab[i];
+        float vq = xI[i] * sinTab[i] + xQ[i] * cosTab[i];
+        xI[i] = vi;
+        xQ[i] = vq;
+    }
+}
+
+static void powerAccumulate_neon(const float *x, float *acc, size_t n) {
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        // deinterleave re/im of 4 complex values
+        float32x4x2_t v = vld2q_f32(x + 2 * i);
+        float32x4_t p = vmlaq_f32(vmulq_f32(v.val[0], v.val[0]), v.val[1], v.val[1]);
+        vst1q_f32(acc + i, vaddq_f32(vld1q_f32(acc + i), p));
+    }
+    for (; i < n; i++) {
+        acc[i] += x[2 * i] * x[2 * i] + x[2 * i + 1] * x[2 * i + 1];
+    }
+}
+
+static inline float hmax128(float32x4_t v) {
+#if defined(__aarch64__)
+    return vmaxvq_f32(v);
+#else
+    float32x2_t m = vmax_f32(vget_low_f32(v), vget_high_f32(v));
+    m = vpmax_f32(m, m);
+    return vget_lane_f32(m, 0);
+#endif
+}
+
+static void maxDecimate_neon(const float *in, const unsigned int *edges, size_t numOut, float *out) {
+    for (size_t i = 0; i < numOut; i++) {
+        unsigned int k = edges[i];
+        const unsigned int end = edges[i + 1];
+        float m = in[k];
+        if (end - k >= 4) {
+            float32x4_t vm = vld1q_f32(in + k);
+            for (k += 4; k + 4 <= end; k += 4) {
+                vm = vmaxq_f32(vm, vld1q_f32(in + k));
+            }
+            m = hmax128(vm);
+        }
+        for (; k < end; k++) {
+            if (in[k] > m) m = in[k];
+        }
+        out[i] = m;
+    }
+}
+
+static void powerToDb_neon(const float *in, size_t n, float scale, float offset, float *out) {
+    const float32x4_t vf = vdupq_n_f32(scale * LOG10_2);
+    const float32x4_t voffset = vdupq_n_f32(offset);
+    const float32x4_t vmin = vdupq_n_f32(POWER_MIN);
+    const uint32x4_t mantMask = vdupq_n_u32(0x007FFFFF);
+    const uint32x4_t one = vdupq_n_u32(0x3F800000);
+    const int32x4_t bias = vdupq_n_s32(127);
+    const float32x4_t c0 = vdupq_n_f32(LOG2_POLY_C0), c1 = vdupq_n_f32(LOG2_POLY_C1);
+    const float32x4_t c2 = vdupq_n_f32(LOG2_POLY_C2), c3 = vdupq_n_f32(LOG2_POLY_C3);
+    const float32x4_t half3 = vdupq_n_f32(1.5f);
+
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        uint32x4_t bits = vreinterpretq_u32_f32(vmaxq_f32(vld1q_f32(in + i), vmin));
+        float32x4_t e = vcvtq_f32_s32(vsubq_s32(vreinterpretq_s32_u32(vshrq_n_u32(bits, 23)), bias));
+        float32x4_t u = vsubq_f32(vreinterpretq_f32_u32(vorrq_u32(vandq_u32(bits, mantMask), one)), half3);
+        float32x4_t p = vmlaq_f32(c2, u, c3);
+        p = vmlaq_f32(c1, u, p);
+        p = vmlaq_f32(c0, u, p);
+        vst1q_f32(out + i, vmlaq_f32(voffset, vaddq_f32(e, p), vf));
+    }
+    if (i < n) {
+        getScalarKernels().powerToDb(in + i, n - i, scale, offset, out + i);
+    }
+}
+
+static float peakAbs_neon(const float *x, size_t n) {
+    float32x4_t vm = vdupq_n_f32(0.0f);
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        vm = vmaxq_f32(vm, vabsq_f32(vld1q_f32(x + i)));
+    }
+    float m = hmax128(vm);
+    if (i < n) {
+        float t = getScalarKernels().peakAbs(x + i, n - i);
+        if (t > m) m = t;
+    }
+    return m;
+}
+
+static void gainRamp_neon(float *x, size_t n, float gain, float step, float clip) {
+    const float32x4_t vstep4 = vdupq_n_f32(4.0f * step);
+    const float32x4_t vclip = vdupq_n_f32(clip);
+    const float32x4_t vnclip = vdupq_n_f32(-clip);
+    const float ramp[4] = {0.0f, 1.0f, 2.0f, 3.0f};
+    float32x4_t vg = vmlaq_n_f32(vdupq_n_f32(gain), vld1q_f32(ramp), step);
+
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        float32x4_t v = vmulq_f32(vld1q_f32(x + i), vg);
+        vst1q_f32(x + i, vmaxq_f32(vminq_f32(v, vclip), vnclip));
+        vg = vaddq_f32(vg, vstep4);
+    }
+    if (i < n) {
+        getScalarKernels().gainRamp(x + i, n - i, gain + static_cast<float>(i) * step, step, clip);
+    }
+}
+
+// rounded int32 of x * 32767, limited to the int16 range
+static inline int32x4_t audioToInt_neon(float32x4_t x) {
+    float32x4_t v = vmulq_n_f32(x, 32767.0f);
+    v = vmaxq_f32(vminq_f32(v, vdupq_n_f32(32767.0f)), vdupq_n_f32(-32768.0f));
+#if defined(__aarch64__)
+    return vcvtnq_s32_f32(v);
+#else
+    // armv7 only truncates: add +-0.5
+    uint32x4_t signBit = vandq_u32(vreinterpretq_u32_f32(v), vdupq_n_u32(0x80000000));
+    float32x4_t half = vreinterpretq_f32_u32(vorrq_u32(vreinterpretq_u32_f32(vdupq_n_f32(0.5f)), signBit));
+    return vcvtq_s32_f32(vaddq_f32(v, half));
+#endif
+}
+
+static void floatToInt16_neon(const float *in, size_t n, int16_t *out) {
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        int16x4_t lo = vqmovn_s32(audioToInt_neon(vld1q_f32(in + i)));
+        int16x4_t hi = vqmovn_s32(audioToInt_neon(vld1q_f32(in + i + 4)));
+        vst1q_s16(out + i, vcombine_s16(lo, hi));
+    }
+    if (i < n) {
+        getScalarKernels().floatToInt16(in + i, n - i, out + i);
+    }
+}
+
+static inline uint32x4_t muLaw4_neon(float32x4_t x) {
+    int32x4_t v = audioToInt_neon(x);
+    uint32x4_t sign = vandq_u32(vreinterpretq_u32_s32(vshrq_n_s32(v, 31)), vdupq_n_u32(0x80));
+    int32x4_t mag = vaddq_s32(vminq_s32(vabsq_s32(v), vdupq_n_s32(MULAW_CLIP)), vdupq_n_s32(MULAW_BIAS));
+
+    // highest bit from the float exponent (mag is exactly representable)
+    int32x4_t e = vreinterpretq_s32_u32(vshrq_n_u32(vreinterpretq_u32_f32(vcvtq_f32_s32(mag)), 23));
+    int32x4_t exponent = vsubq_s32(e, vdupq_n_s32(127 + 7));
+    // right shift = left shift by a negative amount
+    int32x4_t mantissa = vandq_s32(vshlq_s32(mag, vnegq_s32(vaddq_s32(exponent, vdupq_n_s32(3)))), vdupq_n_s32(0x0F));
+
+    uint32x4_t code = vorrq_u32(sign, vreinterpretq_u32_s32(vorrq_s32(vshlq_n_s32(exponent, 4), mantissa)));
+    return veorq_u32(code, vdupq_n_u32(0xFF));
+}
+
+static void floatToMuLaw_neon(const float *in, size_t n, uint8_t *out) {
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        uint16x4_t lo = vmovn_u32(muLaw4_neon(vld1q_f32(in + i)));
+        uint16x4_t hi = vmovn_u32(muLaw4_neon(vld1q_f32(in + i + 4)));
+        vst1_u8(out + i, vmovn_u16(vcombine_u16(lo, hi)));
+    }
+    if (i < n) {
+        getScalarKernels().floatToMuLaw(in + i, n - i, out + i);
+    }
+}
+
+static const SIMDKernels neonKernels = {
+    "NEON",
+    convertInt16_neon,
+    firDecimate_neon,
+    mixPlanar_neon,
+    powerAccumulate_neon,
+    maxDecimate_neon,
+    powerToDb_neon,
+    peakAbs_neon,
+    gainRamp_neon,
+    floatToInt16_neon,
+    floatToMuLaw_neon
+};
+
+const SIMDKernels* getNEONKernels() {
+    return &neonKernels;
+}
+
+#else
+
+const SIMDKernels* getNEONKernels() {
+    return nullptr;
+}
+
+#endif // __ARM_NEON
+#endif // __aarch64__ || __arm__
@@ -0,0 +1,68 @@
+#ifndef SOS_FILTER_H
+#define SOS_FILTER_H
+
+#include <complex>
+#include "liquid.h"
+
+// IIR filter for complex samples with real coefficients, as a cascade of NSECT second order sections
+// (transposed direct form II). The number of sections is a template parameter, so the
+// section loop is unrolled and the state stays in registers for the whole block.
+// The coefficients come from liquid_iirdes(), the result is the same as iirfilt_crcf.
+template <unsigned int NSECT>
+class SOSFilter {
+public:
+    // same parameters as iirfilt_crcf_create_prototype(), order must give NSECT sections
+    // (lowpass: order = 2 * NSECT, bandpass: order = NSECT)
+    void design(liquid_iirdes_filtertype ftype, liquid_iirdes_bandtype btype, unsigned int order,
+                float fc, float f0, float ripple, float stopband) {
+        float B[3 * NSECT], A[3 * NSECT];
+        liquid_iirdes(ftype, btype, LIQUID_IIRDES_SOS, order, fc, f0, ripple, stopband, B, A);
+        for (unsigned int s = 0; s < NSECT; s++) {
+            // normalize to a0 = 1
+            float a0 = A[3 * s];
+            b0[s] = B[3 * s] / a0;
+            b1[s] = B[3 * s + 1] / a0;
+            b2[s] = B[3 * s + 2] / a0;
+            a1[s] = A[3 * s + 1] / a0;
+            a2[s] = A[3 * s + 2] / a0;
+        }
+        reset();
+    }
+
+    void reset() {
+        for (unsigned int s = 0; s < NSECT; s++) {
+            s1[s] = s2[s] = 0.0f;
+        }
+    }
+
+    // in and out may be the same
+    void execute(const liquid_float_complex *in, unsigned int n, liquid_float_complex *out) {
+        std::complex<float> z1[NSECT], z2[NSECT];
+        for (unsigned int s = 0; s < NSECT; s++) {
+            z1[s] = s1[s];
+            z2[s] = s2[s];
+        }
+
+        for (unsigned int i = 0; i < n; i++) {
+            std::complex<float> x = in[i];
+            for (unsigned int s = 0; s < NSECT; s++) {
+                std::complex<float> y = b0[s] * x + z1[s];
+                z1[s] = b1[s] * x - a1[s] * y + z2[s];
+                z2[s] = b2[s] * x - a2[s] * y;
+                x = y;
+            }
+            out[i] = x;
+        }
+
+        for (unsigned int s = 0; s < NSECT; s++) {
+            s1[s] = z1[s];
+            s2[s] = z2[s];
+        }
+    }
+
+private:
+    float b0[NSECT], b1[NSECT], b2[NSECT], a1[NSECT], a2[NSECT];
+    std::complex<float> s1[NSECT], s2[NSECT];
+};
+
+#endif // SOS_FILTER_H
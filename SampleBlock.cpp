@@ -0,0 +1,86 @@
+#include "SampleBlock.h"
+#include <cstdlib>
+#include <new>
+
+// ===== SampleBlockPtr =====
+
+SampleBlockPtr::SampleBlockPtr(SampleBlock* b) : block(b) {
+    if (block) block->refCount.fetch_add(1, std::memory_order_relaxed);
+}
+
+SampleBlockPtr::SampleBlockPtr(const SampleBlockPtr& other) : block(other.block) {
+    if (block) block->refCount.fetch_add(1, std::memory_order_relaxed);
+}
+
+SampleBlockPtr::SampleBlockPtr(SampleBlockPtr&& other) noexcept : block(other.block) {
+    other.block = nullptr;
+}
+
+SampleBlockPtr& SampleBlockPtr::operator=(const SampleBlockPtr& other) {
+    if (this != &other) {
+        if (other.block) other.block->refCount.fetch_add(1, std::memory_order_relaxed);
+        reset();
+        block = other.block;
+    }
+    return *this;
+}
+
+SampleBlockPtr& SampleBlockPtr::operator=(SampleBlockPtr&& other) noexcept {
+    if (this != &other) {
+        reset();
+        block = other.block;
+        other.block = nullptr;
+    }
+    return *this;
+}
+
+SampleBlockPtr::~SampleBlockPtr() {
+    reset();
+}
+
+// drop the reference, the last one returns the block to its pool
+void SampleBlockPtr::reset() {
+    if (block) {
+        if (block->refCount.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            block->pool->release(block);
+        }
+        block = nullptr;
+    }
+}
+
+// ===== SampleBlockPool =====
+
+SampleBlockPool::SampleBlockPool(size_t blockSize, size_t numBlocks)
+    : blockSize(blockSize), blocks(new SampleBlock[numBlocks]), freeList(numBlocks) {
+    // one contiguous, cache line aligned memory area for all blocks
+    size_t bytes = blockSize * numBlocks * sizeof(liquid_float_complex);
+    bytes = (bytes + 63) / 64 * 64;
+    memory = static_cast<liquid_float_complex*>(std::aligned_alloc(64, bytes));
+    if (!memory) throw std::bad_alloc();
+
+    for (size_t i = 0; i < numBlocks; i++) {
+        blocks[i].sdata = memory + i * blockSize;
+        blocks[i].capacity = blockSize;
+        blocks[i].pool = this;
+        freeList.bounded_push(&blocks[i]);
+    }
+}
+
+SampleBlockPool::~SampleBlockPool() {
+    std::free(memory);
+}
+
+SampleBlockPtr SampleBlockPool::acquire() {
+    SampleBlock* b = nullptr;
+    if (!freeList.pop(b)) {
+        exhausted++;
+        return SampleBlockPtr();
+    }
+    b->numSamples = 0;
+    b->sequence = sequence++;
+    return SampleBlockPtr(b);
+}
+
+void SampleBlockPool::release(SampleBlock* b) {
+    freeList.bounded_push(b);
+}
@@ -0,0 +1,81 @@
+#ifndef SAMPLEBLOCK_H
+#define SAMPLEBLOCK_H
+
+#include <complex>
+#include <atomic>
+#include <memory>
+#include <cstdint>
+#include <boost/lockfree/queue.hpp>
+#include "liquid.h"
+
+class SampleBlockPool;
+
+// block of I/Q samples taken from a SampleBlockPool
+// it is filled once by the producer and read only afterwards,
+// all consumers hold a SampleBlockPtr to the same memory
+struct SampleBlock {
+    liquid_float_complex* sdata = nullptr;  // points into the memory of the pool
+    size_t numSamples = 0;                  // valid samples in sdata
+    size_t capacity = 0;                    // max. number of samples
+    uint64_t sequence = 0;                  // running number of the producer
+    std::atomic<int> refCount{0};
+    SampleBlockPool* pool = nullptr;
+};
+
+// reference counted handle to a SampleBlock
+// the block goes back into its pool when the last handle is destroyed
+class SampleBlockPtr {
+public:
+    SampleBlockPtr() = default;
+    explicit SampleBlockPtr(SampleBlock* b);
+    SampleBlockPtr(const SampleBlockPtr& other);
+    SampleBlockPtr(SampleBlockPtr&& other) noexcept;
+    SampleBlockPtr& operator=(const SampleBlockPtr& other);
+    SampleBlockPtr& operator=(SampleBlockPtr&& other) noexcept;
+    ~SampleBlockPtr();
+
+    void reset();
+
+    // write access, only for the producer before the block is handed out
+    SampleBlock* get() const { return block; }
+
+    const SampleBlock* operator->() const { return block; }
+    const SampleBlock& operator*() const { return *block; }
+    explicit operator bool() const { return block != nullptr; }
+
+private:
+    SampleBlock* block = nullptr;
+};
+
+// fixed number of preallocated blocks, no allocation after construction
+// acquire() is called by one producer, blocks may be released from any thread
+// the pool must outlive all handles to its blocks
+class SampleBlockPool {
+public:
+    SampleBlockPool(size_t blockSize, size_t numBlocks);
+    ~SampleBlockPool();
+
+    SampleBlockPool(const SampleBlockPool&) = delete;
+    SampleBlockPool& operator=(const SampleBlockPool&) = delete;
+
+    // get an empty block, returns an empty handle if all blocks are in use
+    SampleBlockPtr acquire();
+
+    size_t getBlockSize() const { return blockSize; }
+
+    // number of failed acquire() calls
+    uint64_t getExhaustedCount() const { return exhausted; }
+
+private:
+    friend class SampleBlockPtr;
+    void release(SampleBlock* b);
+
+    size_t blockSize;
+    std::unique_ptr<SampleBlock[]> blocks;
+    liquid_float_complex* memory = nullptr;
+    boost::lockfree::queue<SampleBlock*, boost::lockfree::fixed_sized<true>> freeList;
+    std::atomic<uint64_t> exhausted{0};
+    uint64_t sequence = 0;
+};
+
+#endif // SAMPLEBLOCK_H
@@ -6,29 +6,12 @@
 using namespace std::chrono;
 
 // Constructor
-SignalDecoder::SignalDecoder() : usblsb(1) {
+SignalDecoder::SignalDecoder() : usblsb(1), agc(AUDIO_SAMPLE_RATE, agcLookaheadMs) {
     setupSignalDecoder();
 }
 
 // Destructor
 SignalDecoder::~SignalDecoder() {
-    // Destroy each filter and set pointers to nullptr
-    if (ssb_filter_500) {
-        iirfilt_crcf_destroy(ssb_filter_500);
-        ssb_filter_500 = nullptr;
-    }
-    if (ssb_filter_1800) {
-        iirfilt_crcf_destroy(ssb_filter_1800);
-        ssb_filter_1800 = nullptr;
-    }
-    if (ssb_filter_2700) {
-        iirfilt_crcf_destroy(ssb_filter_2700);
-        ssb_filter_2700 = nullptr;
-    }
-    if (ssb_filter_3600) {
-        iirfilt_crcf_destroy(ssb_filter_3600);
-        ssb_filter_3600 = nullptr;
-    }
     if (demod_usb) {
         ampmodem_destroy(demod_usb);
         demod_usb = nullptr;
@@ -47,11 +30,11 @@ SignalDecoder::~SignalDecoder() {
     }
 }
 
-void SignalDecoder::create_lowpass_filter(iirfilt_crcf &filter, float fc, float f0) {
-    filter = iirfilt_crcf_create_prototype(
+template <unsigned int NSECT>
+void SignalDecoder::create_lowpass_filter(SOSFilter<NSECT> &filter, float fc, float f0) {
+    filter.design(
         LIQUID_IIRDES_ELLIP,    // Filter type
         LIQUID_IIRDES_LOWPASS,  // Lowpass filter
-        LIQUID_IIRDES_SOS,      // Second-order sections
         order,                  // Filter order
         fc,                     // Bandwidth
         f0,                     // Center frequency
@@ -60,11 +43,11 @@ void SignalDecoder::create_lowpass_filter(iirfilt_crcf &filter, float fc, float
     );
 }
 
-void SignalDecoder::create_bandpass_filter(iirfilt_crcf &filter, float fc, float f0) {
-    filter = iirfilt_crcf_create_prototype(
+template <unsigned int NSECT>
+void SignalDecoder::create_bandpass_filter(SOSFilter<NSECT> &filter, float fc, float f0) {
+    filter.design(
         LIQUID_IIRDES_CHEBY1,   // Filter type
         LIQUID_IIRDES_BANDPASS, // Bandpass filter
-        LIQUID_IIRDES_SOS,      // Second-order sections
         order,                  // Filter order
         fc,                     // Bandwidth
         f0,                     // Center frequency
@@ -92,111 +75,112 @@ void SignalDecoder::setupSignalDecoder() {
     // Create the fractional resampler 48 to 8 kS/s
     resampler_48to8_audio = msresamp_rrrf_create(r_48to8, As_48to8);
 
-    // prepare the audio buffer
-    audioSamples.clear();
-    audioSamples.insert(audioSamples.begin(), 3.0f);    // 3.0f is the ID for audio samples
+    selectPipeline();
 }
 
 void SignalDecoder::setMode(float value) {
     usblsb = static_cast<int>(std::round(value));
+    selectPipeline();
 }
 
 void SignalDecoder::setFilter(float value) {
     filter = static_cast<int>(std::round(value));
     //printf("Filter: %d\n",filter);
+    selectPipeline();
 }
 
 float SignalDecoder::getUsbLsb() {
     return (float(usblsb));
 }
 
-// Decode the SSB signal
-std::vector<float> SignalDecoder::demodulate(ClientInfo &data) {
-    liquid_float_complex *samples_48 = data.sdata.data();
-    unsigned int len48 = data.sdata.size();
-
-    // SSB filter, no filter for FM
-    liquid_float_complex filtered_samples[len48];
-    for (unsigned int i = 0; i < len48; i++) {
-        if(usblsb == 2) {
-            // FM signal cannot be filtered here
-            filtered_samples[i] = samples_48[i];
-        }
-        else {
-            switch (filter) {
-                case 500:   iirfilt_crcf_execute(ssb_filter_500, samples_48[i], &filtered_samples[i]);
-                            break;
-                case 1800:   iirfilt_crcf_execute(ssb_filter_1800, samples_48[i], &filtered_samples[i]);
-                            break;
-                case 2700:   iirfilt_crcf_execute(ssb_filter_2700, samples_48[i], &filtered_samples[i]);
-                            break;
-                case 3600:   iirfilt_crcf_execute(ssb_filter_3600, samples_48[i], &filtered_samples[i]);
-                            break;
-            }            
-        }
+// pipeline for one mode/filter combination, selected in selectPipeline()
+// the mode and the filter are template parameters, so there is no switch in the sample loops
+template <int MODE, int FILTER>
+void SignalDecoder::demodPipeline(liquid_float_complex *samples, unsigned int len, float *audio) {
+    if constexpr (MODE == MODE_FM) {
+        // FM signal cannot be filtered here
+        freqdem_demodulate_block(demod_fm, samples, len, audio);
+    } else {
+        // SSB filter
+        liquid_float_complex *filtered = filteredSamples.data();
+        ssbFilter<FILTER>().execute(samples, len, filtered);
+
+        // SSB demodulator
+        ampmodem_demodulate_block(MODE == MODE_USB ? demod_usb : demod_lsb, filtered, len, audio);
     }
+}
+
+template <int FILTER>
+auto& SignalDecoder::ssbFilter() {
+    if constexpr (FILTER == 500) return ssb_filter_500;
+    else if constexpr (FILTER == 1800) return ssb_filter_1800;
+    else if constexpr (FILTER == 2700) return ssb_filter_2700;
+    else return ssb_filter_3600;
+}
 
-    // SSB demodulator
-    float usb_audio[len48];  // Buffer for demodulated audio
-    for (unsigned int i = 0; i < len48; i++) {
-        if (usblsb == 1)
-            ampmodem_demodulate(demod_usb, filtered_samples[i], &usb_audio[i]);
-        else if(usblsb == 0)
-            ampmodem_demodulate(demod_lsb, filtered_samples[i], &usb_audio[i]);
-        else if(usblsb == 2)
-            freqdem_demodulate(demod_fm, filtered_samples[i], &usb_audio[i]);
+// called when the mode or the filter changes, not per sample block
+void SignalDecoder::selectPipeline() {
+    static const DemodPipeline pipelines[3][4] = {
+        { &SignalDecoder::demodPipeline<MODE_LSB, 500>, &SignalDecoder::demodPipeline<MODE_LSB, 1800>,
+          &SignalDecoder::demodPipeline<MODE_LSB, 2700>, &SignalDecoder::demodPipeline<MODE_LSB, 3600> },
+        { &SignalDecoder::demodPipeline<MODE_USB, 500>, &SignalDecoder::demodPipeline<MODE_USB, 1800>,
+          &SignalDecoder::demodPipeline<MODE_USB, 2700>, &SignalDecoder::demodPipeline<MODE_USB, 3600> },
+        // FM is not filtered, the filter setting does not matter
+        { &SignalDecoder::demodPipeline<MODE_FM, 0>, &SignalDecoder::demodPipeline<MODE_FM, 0>,
+          &SignalDecoder::demodPipeline<MODE_FM, 0>, &SignalDecoder::demodPipeline<MODE_FM, 0> }
+    };
+
+    int m = (usblsb >= MODE_LSB && usblsb <= MODE_FM) ? usblsb : MODE_USB;
+    int f;
+    switch (filter) {
+        case 500:  f = 0; break;
+        case 1800: f = 1; break;
+        case 2700: f = 2; break;
+        default:   f = 3; break;    // 3600 and unknown values
     }
+    pipeline = pipelines[m][f];
+}
 
-    // ===== AGC ======
-    static float targetLevel = 0.3f;     // Desired signal level
-    static float maxGain = 1000.0f;        // Maximum allowed gain
-    static float attack = 1.0f;          // How quickly to reduce gain (faster for loud sounds)
-    static float decay = 0.01f;          // How quickly to restore gain (slower for quiet sounds)
-    static float gain = 1.0f;            // Initial gain
-
-    for (unsigned int i = 0; i < len48; i++) {
-        float absSample = fabs(usb_audio[i] * gain);
-
-        // If the sample is too loud, reduce gain (attack)
-        if (absSample > targetLevel) {
-            gain -= attack * (absSample - targetLevel);
-        }
-        // If the sample is too quiet, increase gain (decay)
-        else if (absSample < targetLevel) {
-            gain += decay * (targetLevel - absSample);
-        }
-
-        // Ensure the gain is within reasonable bounds
-        if (gain > maxGain) gain = maxGain;
-        if (gain < 1.0f) gain = 1.0f;
-
-        usb_audio[i] *= gain;
-
-        // clipping
-        usb_audio[i] = std::max(-0.99f, std::min(usb_audio[i], 0.99f));
+// Decode the SSB signal
+void SignalDecoder::demodulate(ClientInfo &data) {
+    if (!data.samples) return;
+    // liquid does not write into the input, but has no const parameters
+    liquid_float_complex *samples_48 = data.samples->sdata;
+    unsigned int len48 = data.samples->numSamples;
+    if (len48 == 0) return;
+
+    // working buffers grow once to the block size, no allocation afterwards
+    if (filteredSamples.size() < len48) {
+        filteredSamples.resize(len48);
+        audio48.resize(len48);
+        audio8.resize(static_cast<size_t>(r_48to8 * len48) + 16);
     }
-    // =======================
+    float *usb_audio = audio48.data();
+
+    // filter and demodulator of the selected mode
+    (this->*pipeline)(samples_48, len48, usb_audio);
+
+    // AGC, own state per client
+    agc.process(usb_audio, len48);
 
     // downsample from 48 to 8kS/s 
-    unsigned int num_samples_out_8_expected = (unsigned int)(r_48to8 * len48 + 0.5f);
-    float samples_8[num_samples_out_8_expected];
+    float *samples_8 = audio8.data();
     unsigned int num_output_samples_8;
     msresamp_rrrf_execute(resampler_48to8_audio, usb_audio, len48, samples_8, &num_output_samples_8);
 
-    // add the new samples to the buffer
-    audioSamples.insert(audioSamples.end(), samples_8, samples_8 + num_output_samples_8);
-
-    if (audioSamples.size() < 1024) {
-        return std::vector<float>();
-    }
-
-    // Prepare the output vector with 3.0f as the first element, followed by exactly 1024 samples
-    std::vector<float> output(1025); // Create a vector with 1025 elements
-    output[0] = 3.0f; // Set the first element to 3.0f
-    std::copy(audioSamples.begin(), audioSamples.begin() + 1024, output.begin() + 1); // Copy the next 1024 samples
+    // add the new samples to the framer, ClientObject reads the frames with getAudioFrame()
+    audioFramer.write(samples_8, num_output_samples_8);
+}
 
-    // Erase the samples we just used from the buffer
-    audioSamples.erase(audioSamples.begin(), audioSamples.begin() + 1024);
+// next audio frame, returns the number of samples or 0 if not enough samples are available
+unsigned int SignalDecoder::readAudioFrame(float *frame) {
+    if (!audioFramer.readFrame(frame)) return 0;
+    return audioFramer.getFrameSize();
+}
 
-    return output;
+void SignalDecoder::setAudioFrameSize(float value) {
+    unsigned int size = static_cast<unsigned int>(std::round(value));
+    if (!audioFramer.setFrameSize(size)) {
+        printf("invalid audio frame size: %u\n", size);
+    }
 }
@@ -8,6 +8,9 @@
 #include <array>
 #include <iostream>
 #include "global.h"
+#include "AGC.h"
+#include "SOSFilter.h"
+#include "AudioFramer.h"
 
 class SignalDecoder {
 public:
@@ -20,8 +23,15 @@ public:
     // Setup method for initializing SDR components
     void setupSignalDecoder();
 
-    // Decode method for processing samples
-    std::vector<float> demodulate(ClientInfo &data);
+    // Decode method for processing samples, the audio goes into the AudioFramer
+    void demodulate(ClientInfo &data);
+
+    // next audio frame for the browser (max. AudioFramer::MAX_FRAME_SIZE samples),
+    // returns the number of samples, 0 if not enough samples are available
+    unsigned int readAudioFrame(float *frame);
+
+    // audio frame size in samples at 8 kS/s (128, 256, 512 or 1024), set by the browser
+    void setAudioFrameSize(float value);
 
     // set decoder mode usb, lsb, fm
     void setMode(float value);
@@ -33,8 +43,25 @@ public:
     float getUsbLsb();
 
 private:
-    void create_lowpass_filter(iirfilt_crcf &filter, float fc, float f0);
-    void create_bandpass_filter(iirfilt_crcf &filter, float fc, float f0);
+    // modes, values of usblsb
+    static constexpr int MODE_LSB = 0;
+    static constexpr int MODE_USB = 1;
+    static constexpr int MODE_FM = 2;
+
+    // filter and demodulation of one block of 48 kS/s samples into audio
+    typedef void (SignalDecoder::*DemodPipeline)(liquid_float_complex *samples, unsigned int len, float *audio);
+    template <int MODE, int FILTER> void demodPipeline(liquid_float_complex *samples, unsigned int len, float *audio);
+    template <int FILTER> auto& ssbFilter();
+    void selectPipeline();
+    DemodPipeline pipeline = nullptr;
+
+    // working buffers of demodulate()
+    std::vector<liquid_float_complex> filteredSamples;
+    std::vector<float> audio48;
+    std::vector<float> audio8;
+
+    template <unsigned int NSECT> void create_lowpass_filter(SOSFilter<NSECT> &filter, float fc, float f0);
+    template <unsigned int NSECT> void create_bandpass_filter(SOSFilter<NSECT> &filter, float fc, float f0);
 
     // Constants
     const float BANDWIDTH = 2500.0f;
@@ -42,13 +69,13 @@ private:
     float r_48to8 = 8000.0f / AUDIO_SAMPLE_RATE;
     int usblsb = 0;
     int filter = 3600;
-    std::vector<float> audioSamples;
+    AudioFramer audioFramer;
 
-    // SSB Filter
-    iirfilt_crcf ssb_filter_500 = nullptr;
-    iirfilt_crcf ssb_filter_1800 = nullptr;
-    iirfilt_crcf ssb_filter_2700 = nullptr;
-    iirfilt_crcf ssb_filter_3600 = nullptr;
+    // SSB Filter (4th order: the bandpass has 4, the lowpass filters 2 second order sections)
+    SOSFilter<4> ssb_filter_500;
+    SOSFilter<2> ssb_filter_1800;
+    SOSFilter<2> ssb_filter_2700;
+    SOSFilter<2> ssb_filter_3600;
 
     float fc_500 = 1000.0f / AUDIO_SAMPLE_RATE;
     float f0_500 = 500.0f / AUDIO_SAMPLE_RATE;
@@ -58,12 +85,15 @@ private:
     float f0_2700 = 0.0f;
     float fc_3600 = 3600.0f / AUDIO_SAMPLE_RATE; // Normalized cutoff frequency
     float f0_3600 = 0.0f;
-    unsigned int order = 4;  // Filter order, can be adjusted for sharper or smoother roll-off
+    const unsigned int order = 4;  // Filter order, the SOSFilter section counts above depend on it
 
     // Demodulators
     ampmodem demod_usb = nullptr, demod_lsb = nullptr;
     freqdem demod_fm = nullptr;
 
+    // automatic gain control of the demodulated audio
+    AGC agc;
+
     // Resampler for Audio 48k to 8k
     msresamp_rrrf resampler_48to8_audio = nullptr;
     float As_48to8 = 60.0f;               // Stop-band attenuation in dB (60 dB is a good choice)
@@ -0,0 +1,81 @@
+#include "SpanDecimator.h"
+#include <algorithm>
+#include <cstring>
+
+SpanDecimator::SpanDecimator(const SIMDKernels& simdKernels) : kernels(simdKernels) {
+}
+
+unsigned int SpanDecimator::decimationFor(unsigned int sampleRate, unsigned int bandwidth) {
+    unsigned int d = 1;
+    // output rate >= 1.2 * bandwidth, in integers: 5 * rate >= 6 * d * bandwidth
+    while (d < MAX_DECIMATION && 5ull * sampleRate >= 6ull * 2 * d * bandwidth) d *= 2;
+    return d;
+}
+
+void SpanDecimator::configure(unsigned int newDecimation) {
+    decimation = std::max(1u, std::min(newDecimation, MAX_DECIMATION));
+    if (decimation == 1) {
+        numTaps = 0;
+        taps.clear();
+        return;
+    }
+
+    // lowpass with the -6 dB point at the output Nyquist frequency, the band edges are at
+    // 1/1.2 of it, so the transition band ends before anything aliases into the band
+    numTaps = TAPS_PER_DECIMATION * decimation;     // multiple of 8 for the SIMD kernels
+    std::vector<float> h(numTaps);
+    liquid_firdes_kaiser(numTaps, 0.5f / decimation, 60.0f, 0.0f, h.data());
+
+    float sum = 0.0f;
+    for (float v : h) sum += v;
+
+    // the kernels calculate a dot product, so the taps are stored in reversed order
+    taps.resize(numTaps);
+    for (unsigned int i = 0; i < numTaps; i++) {
+        taps[i] = h[numTaps - 1 - i] / sum;
+    }
+
+    bufI.assign(numTaps + decimation + BLOCK_SIZE, 0.0f);
+    bufQ.assign(numTaps + decimation + BLOCK_SIZE, 0.0f);
+    fill = numTaps - 1;
+}
+
+unsigned int SpanDecimator::process(const liquid_float_complex *input, unsigned int numSamples, liquid_float_complex *output) {
+    if (decimation == 1) {
+        std::copy_n(input, numSamples, output);
+        return numSamples;
+    }
+
+    unsigned int numOut = 0;
+    unsigned int pos = 0;
+    while (pos < numSamples) {
+        unsigned int len = std::min(numSamples - pos, BLOCK_SIZE);
+        numOut += processBlock(input + pos, len, output + numOut);
+        pos += len;
+    }
+    return numOut;
+}
+
+unsigned int SpanDecimator::processBlock(const liquid_float_complex *input, unsigned int numSamples, liquid_float_complex *output) {
+    // planar for the SIMD kernels, appended to the filter history
+    for (unsigned int i = 0; i < numSamples; i++) {
+        bufI[fill + i] = input[i].real();
+        bufQ[fill + i] = input[i].imag();
+    }
+    fill += numSamples;
+
+    unsigned int numOut = 0;
+    if (fill >= numTaps) {
+        numOut = (fill - numTaps) / decimation + 1;
+        kernels.firDecimate(bufI.data(), bufQ.data(), taps.data(), numTaps, numOut, decimation,
+                            reinterpret_cast<float*>(output));
+    }
+
+    // keep the samples which are needed for the next output
+    unsigned int consumed = numOut * decimation;
+    fill -= consumed;
+    std::memmove(bufI.data(), bufI.data() + consumed, fill * sizeof(float));
+    std::memmove(bufQ.data(), bufQ.data() + consumed, fill * sizeof(float));
+
+    return numOut;
+}
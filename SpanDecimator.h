@@ -0,0 +1,47 @@
+#ifndef SPAN_DECIMATOR_H
+#define SPAN_DECIMATOR_H
+
+#include <vector>
+#include <complex>
+#include "liquid.h"
+#include "SIMDKernels.h"
+
+// 480 kS/s float I/Q of a virtual band to the sample rate of its span (FFTProcessor):
+// the band is centered at 0 Hz (VirtualBands), it is decimated by a power of two,
+// so the big FFT only transforms the band, e.g. 60 kS/s for the 50 kHz of 30 m
+// and 15 kS/s for the 7 kHz of 630 m
+class SpanDecimator {
+public:
+    static constexpr unsigned int MAX_DECIMATION = 64;    // 7.5 kS/s, bands up to 6 kHz
+    static constexpr unsigned int TAPS_PER_DECIMATION = 24;    // 60 dB stopband before the band edge aliases
+    static constexpr unsigned int BLOCK_SIZE = 2048;            // input samples per step
+
+    explicit SpanDecimator(const SIMDKernels& simdKernels = getSIMDKernels());
+
+    // largest decimation whose output rate is at least 1.2 times the bandwidth
+    static unsigned int decimationFor(unsigned int sampleRate, unsigned int bandwidth);
+
+    // decimation 1 ... MAX_DECIMATION (power of two), clears the filter history
+    void configure(unsigned int decimation);
+    unsigned int getDecimation() const { return decimation; }
+
+    // process numSamples samples, returns the number of output samples
+    // output must have room for numSamples / decimation + 1 samples
+    unsigned int process(const liquid_float_complex *input, unsigned int numSamples, liquid_float_complex *output);
+
+private:
+    unsigned int processBlock(const liquid_float_complex *input, unsigned int numSamples, liquid_float_complex *output);
+
+    const SIMDKernels& kernels;
+
+    unsigned int decimation = 1;
+    unsigned int numTaps = 0;
+    std::vector<float> taps;    // reversed order
+
+    // planar input buffers: filter history followed by the new samples
+    std::vector<float> bufI;
+    std::vector<float> bufQ;
+    unsigned int fill = 0;
+};
+
+#endif // SPAN_DECIMATOR_H
@@ -0,0 +1,45 @@
+#include "SpectrumPyramid.h"
+#include <algorithm>
+#include <cmath>
+
+SpectrumPyramid::SpectrumPyramid(const float *db, unsigned int size, float binHz, float startBin) :
+    binHz(binHz), startBin(startBin) {
+    levels.emplace_back(db, db + size);
+    while (levels.back().size() > MIN_BINS) {
+        const std::vector<float>& below = levels.back();
+        std::vector<float> level(below.size() / 2);
+        for (size_t i = 0; i < level.size(); i++) {
+            level[i] = std::max(below[2 * i], below[2 * i + 1]);
+        }
+        levels.push_back(std::move(level));
+    }
+}
+
+void SpectrumPyramid::extract(float start, float span, unsigned int width, float *out) const {
+    if (width == 0) return;
+
+    // level 0 bins per output bin, the level where it is 1...2
+    float binsPerOutput = span / binHz / width;
+    unsigned int level = 0;
+    while (level + 1 < levels.size() && binsPerOutput >= 2.0f) {
+        binsPerOutput *= 0.5f;
+        level++;
+    }
+
+    const std::vector<float>& bins = levels[level];
+    const float scale = static_cast<float>(1u << level);
+    const float first = (startBin + start / binHz) / scale;
+    const int last = static_cast<int>(bins.size()) - 1;
+
+    for (unsigned int i = 0; i < width; i++) {
+        // bins which overlap the output bin, at least the one at its start (zoom beyond the FFT resolution)
+        int a = static_cast<int>(first + i * binsPerOutput);
+        int b = static_cast<int>(std::ceil(first + (i + 1) * binsPerOutput)) - 1;
+        a = std::min(std::max(a, 0), last);
+        b = std::min(std::max(b, a), last);
+
+        float peak = bins[a];
+        for (int j = a + 1; j <= b; j++) peak = std::max(peak, bins[j]);
+        out[i] = peak;
+    }
+}
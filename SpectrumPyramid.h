@@ -0,0 +1,30 @@
+#ifndef SPECTRUM_PYRAMID_H
+#define SPECTRUM_PYRAMID_H
+
+#include <vector>
+#include <memory>
+
+// dB spectrum of a virtual band at all resolutions, built once per FFT output and shared by its clients:
+// level 0 has the full FFT resolution (fftshift order, the band is centered),
+// every further level half as many bins, each the maximum of two bins of the level below
+// a client window (start, span, width) is cut out of the coarsest level which still has a bin per output bin
+class SpectrumPyramid {
+public:
+    // db: size bins of binHz each, size is a power of two, the band starts at bin startBin (fractional)
+    SpectrumPyramid(const float *db, unsigned int size, float binHz, float startBin);
+
+    // width bins for start ... start + span (Hz above the band start), each the maximum of the bins it covers
+    void extract(float start, float span, unsigned int width, float *out) const;
+
+    // smallest level
+    static const unsigned int MIN_BINS = 256;
+
+private:
+    std::vector<std::vector<float>> levels;
+    float binHz;
+    float startBin;
+};
+
+typedef std::shared_ptr<const SpectrumPyramid> SpectrumPyramidPtr;
+
+#endif // SPECTRUM_PYRAMID_H
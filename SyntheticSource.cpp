@@ -0,0 +1,100 @@
+#include "SyntheticSource.h"
+#include "IngestProcessor.h"
+#include "global.h"
+#include <chrono>
+#include <random>
+#include <cmath>
+#include <algorithm>
+
+using namespace std::chrono;
+
+// 1 ms of samples per chunk
+static const size_t SYNTH_CHUNK_SIZE = IQ_SOURCE_SAMPLE_RATE / 1000;
+
+// prime, so the noise does not repeat in sync with the chunks
+static const size_t NOISE_TABLE_SIZE = 65521 * 2;
+
+SyntheticSource::SyntheticSource(bool realtime)
+    : realtime(realtime), chunkI(SYNTH_CHUNK_SIZE), chunkQ(SYNTH_CHUNK_SIZE) {
+    // fixed seed: every run produces the same signal
+    std::mt19937 gen(4711);
+    std::normal_distribution<float> dist(0.0f, 1.0f);
+    noiseTable.resize(NOISE_TABLE_SIZE);
+    for (auto& v : noiseTable) v = dist(gen);
+
+    // default signal: carriers of different strength spread over the displayed 480 kHz
+    setNoiseLevel(-70.0f);
+    addTone(-200000.0f, -30.0f);
+    addTone(-120500.0f, -60.0f);
+    addTone(-50000.0f, -40.0f);
+    addTone(1000.0f, -50.0f);
+    addTone(75300.0f, -65.0f);
+    addTone(180000.0f, -35.0f);
+}
+
+SyntheticSource::~SyntheticSource() {
+    running = false;
+    if (thread.joinable()) thread.join();
+}
+
+void SyntheticSource::addTone(float offset, float level) {
+    Tone t;
+    t.phasor = 1.0;
+    t.step = std::polar(1.0, 2.0 * M_PI * offset / IQ_SOURCE_SAMPLE_RATE);
+    t.amplitude = 32767.0f * std::pow(10.0f, level / 20.0f);
+    tones.push_back(t);
+}
+
+void SyntheticSource::setNoiseLevel(float level) {
+    // per I and Q component
+    noiseAmplitude = 32767.0f * std::pow(10.0f, level / 20.0f) / std::sqrt(2.0f);
+}
+
+bool SyntheticSource::init(uint32_t frequency) {
+    printf("generating %d carriers %s\n", (int)tones.size(), realtime ? "in real time" : "as fast as possible");
+    running = true;
+    thread = std::thread(&SyntheticSource::generatorThread, this);
+    return true;
+}
+
+void SyntheticSource::generateChunk(size_t n) {
+    for (size_t i = 0; i < n; i++) {
+        float vi = noiseTable[noiseIndex] * noiseAmplitude;
+        float vq = noiseTable[noiseIndex + 1] * noiseAmplitude;
+        noiseIndex += 2;
+        if (noiseIndex >= NOISE_TABLE_SIZE) noiseIndex = 0;
+
+        for (auto& t : tones) {
+            vi += t.amplitude * static_cast<float>(t.phasor.real());
+            vq += t.amplitude * static_cast<float>(t.phasor.imag());
+            t.phasor *= t.step;
+        }
+
+        chunkI[i] = static_cast<short>(std::max(-32768.0f, std::min(vi, 32767.0f)));
+        chunkQ[i] = static_cast<short>(std::max(-32768.0f, std::min(vq, 32767.0f)));
+    }
+
+    // keep the amplitude of the phasors exactly at 1
+    for (auto& t : tones) t.phasor /= std::abs(t.phasor);
+}
+
+void SyntheticSource::generatorThread() {
+    IngestProcessor& ingest = IngestProcessor::getInstance();
+    uint64_t totalSamples = 0;
+    auto start = steady_clock::now();
+
+    while (running && keeprunning) {
+        generateChunk(SYNTH_CHUNK_SIZE);
+
+        if (realtime) {
+            std::this_thread::sleep_until(start + microseconds(totalSamples * 1000000 / IQ_SOURCE_SAMPLE_RATE));
+        } else {
+            while (ingest.getRawRingSpace() < SYNTH_CHUNK_SIZE && running) {
+                std::this_thread::sleep_for(microseconds(100));
+            }
+        }
+
+        ingest.pushRawSamples(chunkI.data(), chunkQ.data(), SYNTH_CHUNK_SIZE, 0);
+        totalSamples += SYNTH_CHUNK_SIZE;
+    }
+}
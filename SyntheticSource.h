@@ -0,0 +1,51 @@
+#ifndef SYNTHETIC_SOURCE_H
+#define SYNTHETIC_SOURCE_H
+
+#include <thread>
+#include <atomic>
+#include <vector>
+#include <complex>
+#include "IQSource.h"
+
+// generates a reproducible 2.4 MS/s test signal: several carriers plus noise
+class SyntheticSource : public IQSource {
+public:
+    // realtime: pace the samples like the hardware, otherwise as fast as the ingest thread can take them
+    explicit SyntheticSource(bool realtime);
+    ~SyntheticSource() override;
+
+    bool init(uint32_t frequency) override;
+    void setFrequency(uint32_t frequency) override {}
+    const char* getName() const override { return "synthetic test signal"; }
+
+    // add a carrier, offset from the tuning frequency in Hz, level in dBFS
+    void addTone(float offset, float level);
+
+    // level of the (white) noise in dBFS
+    void setNoiseLevel(float level);
+
+private:
+    void generateChunk(size_t n);
+    void generatorThread();
+
+    struct Tone {
+        std::complex<double> phasor;    // current phase
+        std::complex<double> step;      // rotation per sample
+        float amplitude;
+    };
+    std::vector<Tone> tones;
+
+    // precalculated gaussian noise, repeating table with prime length
+    std::vector<float> noiseTable;
+    size_t noiseIndex = 0;
+    float noiseAmplitude = 0.0f;
+
+    bool realtime;
+    std::vector<short> chunkI;
+    std::vector<short> chunkQ;
+
+    std::thread thread;
+    std::atomic<bool> running{false};
+};
+
+#endif // SYNTHETIC_SOURCE_H
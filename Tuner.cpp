@@ -1,9 +1,13 @@
 #include "Tuner.h"
 #include "SDRHardware.h"
+#include "Channelizer.h"
+#include "FFTPlanCache.h"
 #include "liquid.h"
+#include <cmath>
 
 // Constructor
 Tuner::Tuner() :
+    basebandPool(CHANNELIZER_IFFT_SIZE - CHANNELIZER_DISCARD, 128),
     frequency_shift(0.0f),
     change_frequency(0) {
     setupTuner();
@@ -11,9 +15,13 @@ Tuner::Tuner() :
 
 // Destructor
 Tuner::~Tuner() {
-    if(resampler_480to48) {
-        msresamp_crcf_destroy(resampler_480to48);
-        resampler_480to48 = nullptr;
+    if(ifftIn) {
+        fftwf_free(ifftIn);
+        ifftIn = nullptr;
+    }
+    if(ifftOut) {
+        fftwf_free(ifftOut);
+        ifftOut = nullptr;
     }
     if(nco) {
         nco_crcf_destroy(nco);
@@ -23,15 +31,15 @@ Tuner::~Tuner() {
 
 // Setup method to initialize the SDR components
 void Tuner::setupTuner() {
-    
-    float As_480to48 = 60.0f;
 
-    // Initialize resamplers
-    resampler_480to48 = msresamp_crcf_create(r_480to48, As_480to48);
+    // small inverse FFT, produces 48 kS/s directly
+    ifftIn = (fftwf_complex*) fftwf_malloc(sizeof(fftwf_complex) * CHANNELIZER_IFFT_SIZE);
+    ifftOut = (fftwf_complex*) fftwf_malloc(sizeof(fftwf_complex) * CHANNELIZER_IFFT_SIZE);
+    ifftPlan = FFTPlanCache::getInstance().getPlan(CHANNELIZER_IFFT_SIZE, FFTW_BACKWARD);
 
-    // Initialize the frequency shifter (NCO)
+    // Initialize the fine frequency shifter (NCO)
     nco = nco_crcf_create(LIQUID_NCO);
-    normalized_frequency = 2.0f * M_PI * frequency_shift / SAMPLE_RATE;
+    normalized_frequency = 0.0f;
     nco_crcf_set_frequency(nco, normalized_frequency);
 }
 
@@ -39,9 +47,16 @@ void Tuner::setupTuner() {
 // value: offset Frquency above band start
 void Tuner::setRXFrequencyOffset(float value) {
     //printf("setRXFrequencyOffset value:%f\n",value);
-    // Band start offet is at -240kHz
-    frequency_shift = value - 240000.0f;
-    normalized_frequency = 2.0f * M_PI * frequency_shift / SAMPLE_RATE;
+    rx_offset = value;
+    frequency_shift = rx_offset - center_offset;
+    change_frequency = 1;
+}
+
+// value: distance of the segment center from the band start (half the bandwidth, see VirtualBands)
+void Tuner::setBandCenterOffset(float value) {
+    if (value == center_offset) return;
+    center_offset = value;
+    frequency_shift = rx_offset - center_offset;
     change_frequency = 1;
 }
 
@@ -51,35 +66,62 @@ float Tuner::getFrequencyShift() {
 
 // Decode the SSB signal
 ClientInfo Tuner::doTuning(ClientInfo clientInfo) {
+    ClientInfo samples_baseband_48;
+    if(!clientInfo.samples) return samples_baseband_48;
 
-    liquid_float_complex *data = clientInfo.sdata.data();
-    // data are the raw I/Q samples in liquid DSP format
-    // with a speed of 480 kS/s
-
-    // Mix down of the wanted frequency to the baseband
+    // coarse tuning: select the Channelizer bin next to the wanted frequency
+    // fine tuning: the remaining offset (max. +-50 Hz) is removed by the NCO at 48 kS/s
     if(change_frequency == 1) {
         change_frequency = 0;
+        centerBin = static_cast<int>(std::round(frequency_shift / CHANNELIZER_BIN_HZ));
+        float residual = frequency_shift - centerBin * CHANNELIZER_BIN_HZ;
+        normalized_frequency = 2.0f * M_PI * residual / AUDIO_SAMPLE_RATE;
         nco_crcf_set_frequency(nco, normalized_frequency);
     }
-    unsigned int len480 = clientInfo.sdata.size();
-    liquid_float_complex samplesBaseband[len480];
-    for (unsigned int i = 0; i < len480; i++) {
-        nco_crcf_mix_down(nco, data[i], &samplesBaseband[i]);
-        nco_crcf_step(nco);
+
+    const SampleBlock& frame = *clientInfo.samples;
+    const std::vector<liquid_float_complex>& H = Channelizer::getInstance().getSliceFilter();
+    const int N = CHANNELIZER_FFT_SIZE;
+    const int M = CHANNELIZER_IFFT_SIZE;
+
+    // pick the M bins around centerBin and apply the channel filter
+    int firstBin = ((centerBin - M / 2) % N + N) % N;
+    for (int m = 0; m < M; m++) {
+        int j = (m + M / 2) % M;        // IFFT order: bin centerBin goes to index 0
+        int k = firstBin + m;
+        if (k >= N) k -= N;
+        liquid_float_complex y = frame.sdata[k] * H[j];
+        ifftIn[j][0] = y.real();
+        ifftIn[j][1] = y.imag();
     }
 
-    // samplesBaseband are the I/Q samples of the wanted frequency
-    // with a speed of 480 kS/s
+    fftwf_execute_dft(ifftPlan, ifftIn, ifftOut);
 
-    // all other processing is done at 48 kS/s, so downsample by 10
-    unsigned int num_samples_48_expected = (unsigned int)(r_480to48 * len480 + 0.5f);
-    liquid_float_complex samples_48[num_samples_48_expected];
-    unsigned int num_samples_48;
-    msresamp_crcf_execute(resampler_480to48, samplesBaseband, len480, samples_48, &num_samples_48);
+    // the block starts at sample blockIndex * HOP, so the shift by centerBin has a phase offset
+    // of -2*pi*centerBin*HOP*blockIndex/N which must be removed to get a continuous signal
+    uint64_t k0 = static_cast<uint64_t>(((centerBin % N) + N) % N);
+    uint64_t phaseIndex = (k0 * CHANNELIZER_HOP % N) * (frame.sequence % N) % N;
+    float phase = -2.0f * M_PI * static_cast<float>(phaseIndex) / N;
+    liquid_float_complex rot(std::cos(phase), std::sin(phase));
 
-    // samples_48 are the I/Q samples of the wanted frequency
-    ClientInfo samples_baseband_48;
-    samples_baseband_48.sdata.assign(samples_48, samples_48 + num_samples_48);
+    SampleBlockPtr out = basebandPool.acquire();
+    if(!out) {
+        std::cerr << "Tuner: no free baseband block, samples dropped" << std::endl;
+        return samples_baseband_48;
+    }
+
+    // the first CHANNELIZER_DISCARD samples are invalid (overlap-save)
+    const int num_samples_48 = M - CHANNELIZER_DISCARD;
+    liquid_float_complex* dst = out.get()->sdata;
+    for (int i = 0; i < num_samples_48; i++) {
+        liquid_float_complex v(ifftOut[CHANNELIZER_DISCARD + i][0], ifftOut[CHANNELIZER_DISCARD + i][1]);
+        v *= rot;
+        nco_crcf_mix_down(nco, v, &dst[i]);
+        nco_crcf_step(nco);
+    }
+    out.get()->numSamples = num_samples_48;
+    samples_baseband_48.samples = std::move(out);
 
+    // samples_baseband_48 are the I/Q samples of the wanted frequency
     return samples_baseband_48;
 }
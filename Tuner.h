@@ -4,10 +4,12 @@
 #include <vector>
 #include <boost/lockfree/spsc_queue.hpp>
 #include <complex>
+#include <fftw3.h>
 #include "liquid.h"
 #include <array>
 #include <iostream>
 #include "global.h"
+#include "SampleBlock.h"
 
 class Tuner {
 public:
@@ -23,19 +25,34 @@ public:
     // Method for setting RX frequency offset
     void setRXFrequencyOffset(float value);
 
+    // the band start is this far below the segment center, the shift is relative to the center
+    void setBandCenterOffset(float value);
+
     // read the current freq shift
     float getFrequencyShift();
 
     // Decode method for processing samples
+    // takes a shared spectrum from the Channelizer and returns the 48 kS/s baseband samples
     ClientInfo doTuning(ClientInfo clientInfo);
 
 private:
-    msresamp_crcf resampler_480to48 = nullptr;
+    // inverse FFT of the selected bins (runs at 48 kS/s), the plan is shared (FFTPlanCache)
+    fftwf_plan ifftPlan = nullptr;
+    fftwf_complex* ifftIn = nullptr;
+    fftwf_complex* ifftOut = nullptr;
+
+    // fine tuning below the bin raster of the Channelizer, runs at 48 kS/s
     nco_crcf nco = nullptr;
 
+    // 48 kS/s output blocks, shared with the SignalDecoder and the NarrowFFTProcessor
+    SampleBlockPool basebandPool;
+
     float normalized_frequency;
     float frequency_shift;
+    float rx_offset = 0.0f;             // Hz above the band start
+    float center_offset = 240000.0f;    // Hz from the band start to the segment center
     int change_frequency;
+    int centerBin = 0;      // Channelizer bin which is shifted into the baseband
 
     // Helper methods
     float roundToNearestStep(float num, float step);
@@ -43,7 +60,6 @@ private:
     // Constants
     const float SAMPLE_RATE = 480000.0f;
     const float AUDIO_SAMPLE_RATE = 48000.0f;
-    float r_480to48 = AUDIO_SAMPLE_RATE / SAMPLE_RATE;
 };
 
 #endif // Tuner_H
@@ -0,0 +1,152 @@
+#include "VirtualBands.h"
+#include "global.h"
+#include <stdio.h>
+#include <algorithm>
+
+// max. distance of a segment center from the tuner frequency
+// the segment edges must stay within the IF filter (+-768 kHz)
+const int32_t VBAND_MAX_OFFSET = 768000 - VBAND_WIDTH / 2;
+
+// Singleton instance
+VirtualBands& VirtualBands::getInstance() {
+    static VirtualBands instance;
+    return instance;
+}
+
+VirtualBands::VirtualBands() {
+    // band number (as used by the browser), start and end frequency
+    bands = {
+        {630, start_630m, end_630m},
+        {160, start_160m, end_160m},
+        {80, start_80m, end_80m},
+        {60, start_60m, end_60m},
+        {40, start_40m, end_40m},
+        {30, start_30m, end_30m},
+        {20, start_20m, end_20m},
+        {17, start_17m, end_17m},
+        {15, start_15m, end_15m},
+        {12, start_12m, end_12m},
+        {11, start_11m, end_11m},
+        {280, start_10m_a, end_10m_a},
+        {285, start_10m_b, end_10m_b},
+        {290, start_10m_c, end_10m_c},
+        {6, start_6m, end_6m},
+        {4, start_4m, end_4m},
+        {144, start_2m_a, end_2m_a},    // 144-144.5 MHz
+        {145, start_2m_b, end_2m_b},    // 144.5-145 MHz
+        {146, start_2m_c, end_2m_c},    // 145-145.5 MHz
+        {147, start_2m_d, end_2m_d},    // 145.5-146 MHz
+        {438, start_70cm_a, end_70cm_a},
+        {70, start_70cm, end_70cm},
+        {446, start_PMR446, end_PMR446},
+    };
+
+    // make sure the bandwidth does not exceed 480kHz
+    for (auto& b : bands) b.end = std::min(b.end, b.start + VBAND_WIDTH);
+
+    // bands which are received together, a band which is in no list gets its own group
+    // a band may be in more than one group, the first group which contains it is used
+    const std::vector<std::vector<int>> groupList = {
+        {280, 285},
+        {285, 290},
+        {144, 145, 146},
+        {145, 146, 147},
+    };
+
+    auto addGroup = [this](const std::vector<int>& list) {
+        BandGroup g;
+        for (int band : list) g.vbands.push_back(findBand(band));
+
+        // the tuner is set to the middle between the outer segment centers
+        uint32_t first = g.vbands.front()->center();
+        uint32_t last = g.vbands.back()->center();
+        g.tunerFrequency = first + (last - first) / 2;
+
+        if (static_cast<int32_t>(last - g.tunerFrequency) > VBAND_MAX_OFFSET) {
+            printf("VirtualBands: band group %d..%d is too wide\n", list.front(), list.back());
+        }
+        groups.push_back(g);
+    };
+
+    for (const auto& list : groupList) addGroup(list);
+    for (const auto& b : bands) {
+        bool grouped = false;
+        for (const auto& list : groupList) {
+            if (std::find(list.begin(), list.end(), b.band) != list.end()) grouped = true;
+        }
+        if (!grouped) addGroup({b.band});
+    }
+
+    // start with 20m
+    selectGroup(20);
+}
+
+const VirtualBands::BandEntry* VirtualBands::findBand(int band) const {
+    for (const auto& b : bands) {
+        if (b.band == band) return &b;
+    }
+    return nullptr;
+}
+
+bool VirtualBands::selectGroup(int band) {
+    // stay in the current group if possible
+    if (getVBand(band) >= 0) return true;
+
+    for (size_t i = 0; i < groups.size(); i++) {
+        for (const BandEntry* e : groups[i].vbands) {
+            if (e->band == band) {
+                groupIndex = static_cast<int>(i);
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+const VirtualBands::BandEntry* VirtualBands::entry(int vband) const {
+    const BandGroup& g = currentGroup();
+    if (vband < 0 || vband >= static_cast<int>(g.vbands.size())) return nullptr;
+    return g.vbands[vband];
+}
+
+uint32_t VirtualBands::getTunerFrequency() const {
+    return currentGroup().tunerFrequency;
+}
+
+int VirtualBands::getNumVBands() const {
+    return static_cast<int>(currentGroup().vbands.size());
+}
+
+int VirtualBands::getVBand(int band) const {
+    const BandGroup& g = currentGroup();
+    for (size_t i = 0; i < g.vbands.size(); i++) {
+        if (g.vbands[i]->band == band) return static_cast<int>(i);
+    }
+    return -1;
+}
+
+int VirtualBands::getBand(int vband) const {
+    const BandEntry* e = entry(vband);
+    return e ? e->band : 0;
+}
+
+uint32_t VirtualBands::getStartQRG(int vband) const {
+    const BandEntry* e = entry(vband);
+    return e ? e->start : 0;
+}
+
+uint32_t VirtualBands::getEndQRG(int vband) const {
+    const BandEntry* e = entry(vband);
+    return e ? e->end : VBAND_WIDTH;
+}
+
+uint32_t VirtualBands::getCenterFrequency(int vband) const {
+    const BandEntry* e = entry(vband);
+    return e ? e->center() : 0;
+}
+
+int32_t VirtualBands::getOffset(int vband) const {
+    const BandEntry* e = entry(vband);
+    if (!e) return 0;
+    return static_cast<int32_t>(e->center() - currentGroup().tunerFrequency);
+}
@@ -0,0 +1,72 @@
+#ifndef VIRTUAL_BANDS_H
+#define VIRTUAL_BANDS_H
+
+#include <atomic>
+#include <vector>
+#include <cstdint>
+
+// The SDR delivers 2.4 MS/s, the IF filter (1.536 MHz) leaves about +-750 kHz usable.
+// Within this range up to MAX_VBANDS segments of 480 kHz (virtual bands) are served
+// at the same time, every one with its own waterfall. A segment is centered on its band,
+// so bands up to 400 kHz stay within the alias free +-200 kHz of the IngestDecimator. Users can switch between the
+// virtual bands of the current band group without retuning the hardware.
+const int MAX_VBANDS = 3;
+const uint32_t VBAND_WIDTH = 480000;
+
+class VirtualBands {
+public:
+    static VirtualBands& getInstance();
+
+    // selects the band group which contains the band (band number as used by the browser)
+    // returns false if the band is unknown
+    bool selectGroup(int band);
+
+    // hardware tuning frequency for the current band group
+    uint32_t getTunerFrequency() const;
+
+    // number of virtual bands in the current band group
+    int getNumVBands() const;
+
+    // index of the band in the current band group, -1 if it is not in this group
+    int getVBand(int band) const;
+
+    // properties of a virtual band of the current band group
+    int getBand(int vband) const;
+    uint32_t getStartQRG(int vband) const;
+    uint32_t getEndQRG(int vband) const;
+    uint32_t getCenterFrequency(int vband) const;   // middle between start and end
+    int32_t getOffset(int vband) const;             // center - tuner frequency
+
+    // number of clients which use a virtual band, the ingest only processes bands with subscribers
+    void setSubscribers(int vband, int num) { subscribers[vband] = num; }
+    bool hasSubscribers(int vband) const { return subscribers[vband] > 0; }
+
+private:
+    VirtualBands();
+
+    VirtualBands(const VirtualBands&) = delete;
+    VirtualBands& operator=(const VirtualBands&) = delete;
+
+    struct BandEntry {
+        int band;
+        uint32_t start;
+        uint32_t end;
+        uint32_t center() const { return start + (end - start) / 2; }
+    };
+
+    struct BandGroup {
+        std::vector<const BandEntry*> vbands;
+        uint32_t tunerFrequency;
+    };
+
+    const BandEntry* findBand(int band) const;
+    const BandGroup& currentGroup() const { return groups[groupIndex]; }
+    const BandEntry* entry(int vband) const;
+
+    std::vector<BandEntry> bands;
+    std::vector<BandGroup> groups;
+    std::atomic<int> groupIndex{0};
+    std::atomic<int> subscribers[MAX_VBANDS] = {};
+};
+
+#endif // VIRTUAL_BANDS_H
@@ -0,0 +1,152 @@
+#include "WaterfallCodec.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+// a keyframe at least every 16 lines (1.6 s), so a lost line is repaired quickly
+static const unsigned int KEYFRAME_INTERVAL = 16;
+
+// the range follows the noise floor in steps of 5 dB
+static const float RANGE_MARGIN = 10.0f;    // q = 0 is this far below the noise floor
+static const float RANGE_HYSTERESIS = 10.0f;
+
+WaterfallEncoder::WaterfallEncoder(uint8_t waterfall) : waterfall(waterfall) {
+}
+
+// writes the bits MSB first
+class BitWriter {
+public:
+    BitWriter(uint8_t *buffer, unsigned int size) : buf(buffer), capacity(size) {}
+
+    void write(uint32_t value, unsigned int numBits) {
+        acc = (acc << numBits) | (value & ((1u << numBits) - 1));
+        accBits += numBits;
+        while (accBits >= 8) {
+            accBits -= 8;
+            if (pos < capacity) buf[pos] = static_cast<uint8_t>(acc >> accBits);
+            pos++;
+        }
+    }
+
+    void writeOnes(unsigned int n) {
+        while (n > 16) {
+            write(0xFFFF, 16);
+            n -= 16;
+        }
+        write((1u << n) - 1, n);
+    }
+
+    // returns the number of bytes, more than the capacity if the data did not fit
+    unsigned int flush() {
+        if (accBits > 0) write(0, 8 - accBits);
+        return pos;
+    }
+
+private:
+    uint8_t *buf;
+    unsigned int capacity;
+    unsigned int pos = 0;
+    uint64_t acc = 0;
+    unsigned int accBits = 0;
+};
+
+void WaterfallEncoder::updateRange(const float *db, unsigned int n) {
+    // noise floor: median of the line
+    sortBuffer.assign(db, db + n);
+    std::nth_element(sortBuffer.begin(), sortBuffer.begin() + n / 2, sortBuffer.end());
+    float floorDb = sortBuffer[n / 2];
+
+    float wanted = floorDb - RANGE_MARGIN;
+    if (wanted < rangeLow || wanted > rangeLow + RANGE_HYSTERESIS) {
+        rangeLow = std::floor(wanted / 5.0f) * 5.0f;
+        havePrevious = false;   // the q values change, start with a keyframe
+    }
+}
+
+void WaterfallEncoder::encode(const std::array<float, 1025>& bins, ClientTXData& txdata) {
+    encode(&bins[1], 1024, txdata);
+}
+
+void WaterfallEncoder::encode(const float *db, unsigned int n, ClientTXData& txdata) {
+    n = std::min(n, WATERFALL_MAX_BINS);
+    if (n != previousBins) havePrevious = false;
+
+    updateRange(db, n);
+
+    // quantize
+    const float inv = 1.0f / step;
+    for (unsigned int i = 0; i < n; i++) {
+        float q = (db[i] - rangeLow) * inv + 0.5f;
+        q = std::min(std::max(q, 0.0f), 255.0f);
+        current[i] = static_cast<uint8_t>(q);
+    }
+
+    bool keyframe = !havePrevious || linesSinceKeyframe >= KEYFRAME_INTERVAL;
+
+    // residuals: difference to the previous line or, in a keyframe, to the left neighbour
+    for (unsigned int i = 0; i < n; i++) {
+        int ref = keyframe ? (i > 0 ? current[i - 1] : 0) : previous[i];
+        int r = static_cast<int>(current[i]) - ref;
+        residuals[i] = static_cast<uint16_t>(r >= 0 ? 2 * r : -2 * r - 1);    // zigzag: 0, -1, 1, -2 ... -> 0, 1, 2, 3 ...
+    }
+
+    // Rice parameter with the smallest size
+    unsigned int bestK = 0;
+    unsigned int bestBits = ~0u;
+    for (unsigned int k = 0; k <= 7; k++) {
+        unsigned int bits = 0;
+        for (unsigned int i = 0; i < n; i++) {
+            unsigned int u = residuals[i] >> k;
+            bits += u >= WATERFALL_RICE_ESCAPE ? WATERFALL_RICE_ESCAPE + 9 : u + 1 + k;
+        }
+        if (bits < bestBits) {
+            bestBits = bits;
+            bestK = k;
+        }
+    }
+
+    // header
+    uint8_t *out = reinterpret_cast<uint8_t*>(txdata.data.data());
+    const unsigned int capacity = sizeof(txdata.data) - WATERFALL_HEADER_SIZE;
+    uint16_t numBins = static_cast<uint16_t>(n);
+    std::memcpy(out, &WATERFALL_ID_ENCODED, sizeof(float));
+    out[4] = WATERFALL_CODEC_VERSION;
+    out[5] = waterfall;
+    out[7] = sequence++;
+    std::memcpy(out + 8, &rangeLow, sizeof(float));
+    std::memcpy(out + 12, &step, sizeof(float));
+    std::memcpy(out + 16, &numBins, sizeof(numBins));
+    out[18] = static_cast<uint8_t>(bestK);
+    out[19] = 0;
+
+    unsigned int payload;
+    if ((bestBits + 7) / 8 < n) {
+        BitWriter bw(out + WATERFALL_HEADER_SIZE, capacity);
+        for (unsigned int i = 0; i < n; i++) {
+            unsigned int u = residuals[i] >> bestK;
+            if (u >= WATERFALL_RICE_ESCAPE) {
+                bw.writeOnes(WATERFALL_RICE_ESCAPE);
+                bw.write(residuals[i], 9);
+            } else {
+                bw.writeOnes(u);
+                bw.write(0, 1);
+                if (bestK) bw.write(residuals[i], bestK);
+            }
+        }
+        payload = bw.flush();
+        out[6] = keyframe ? 1 : 0;
+    } else {
+        // noise which does not compress: the plain 8 bit values
+        std::memcpy(out + WATERFALL_HEADER_SIZE, current.data(), n);
+        payload = n;
+        keyframe = true;
+        out[6] = 1 | 2;
+    }
+
+    txdata.length = WATERFALL_HEADER_SIZE + payload;
+
+    previous = current;
+    previousBins = n;
+    havePrevious = true;
+    linesSinceKeyframe = keyframe ? 0 : linesSinceKeyframe + 1;
+}
@@ -0,0 +1,67 @@
+#ifndef WATERFALL_CODEC_H
+#define WATERFALL_CODEC_H
+
+#include <array>
+#include <vector>
+#include <cstdint>
+#include "global.h"
+
+// compressed waterfall lines, used if the browser asks for it (message ID 7)
+// the dB values are quantized to 8 bit against a tracked range, each line is coded as the
+// difference to the previous line (or to the left neighbour in a keyframe) and packed with a Rice code
+//
+// wire format version 1, little endian:
+//   0  float32  ID 9
+//   4  uint8    version (1)
+//   5  uint8    waterfall: 0 = wideband (like ID 0), 1 = narrow (like ID 1),
+//               2 = wideband history after connecting (WaterfallHistory), newest line first
+//   6  uint8    flags: bit 0 keyframe, bit 1 raw (no Rice code, numBins uint8 values)
+//   7  uint8    sequence number, +1 per line
+//   8  float32  dB value of q = 0
+//   12 float32  dB per step of q
+//   16 uint16   number of bins
+//   18 uint8    Rice parameter k
+//   19 uint8    0
+//   20 ...      bit stream, MSB first: per bin zigzag(residual) as Rice code,
+//               a unary part of WATERFALL_RICE_ESCAPE ones is followed by the 9 bit value
+// a delta line can only be decoded if the previous line was received, otherwise wait for the next keyframe
+const float WATERFALL_ID_ENCODED = 9.0f;
+const uint8_t WATERFALL_CODEC_VERSION = 1;
+const unsigned int WATERFALL_HEADER_SIZE = 20;
+const unsigned int WATERFALL_RICE_ESCAPE = 16;
+const unsigned int WATERFALL_MAX_BINS = 2048;   // the raw format of a line must fit into a ClientTXData
+
+class WaterfallEncoder {
+public:
+    // waterfall: 0 = wideband, 1 = narrow, 2 = wideband history
+    explicit WaterfallEncoder(uint8_t waterfall);
+
+    // dB values of one line (bins[0] is the ID of the float format and is not used),
+    // the encoded line is written into txdata
+    void encode(const std::array<float, 1025>& bins, ClientTXData& txdata);
+
+    // line of n (<= WATERFALL_MAX_BINS) dB values, a new n starts with a keyframe
+    void encode(const float *db, unsigned int n, ClientTXData& txdata);
+
+    // next line is a keyframe
+    void reset() { havePrevious = false; }
+
+private:
+    void updateRange(const float *db, unsigned int n);
+
+    uint8_t waterfall;
+    uint8_t sequence = 0;
+    unsigned int linesSinceKeyframe = 0;
+    bool havePrevious = false;
+
+    float rangeLow = -140.0f;       // dB value of q = 0
+    const float step = 0.5f;        // dB per step, 0...255 covers 127 dB
+
+    unsigned int previousBins = 0;
+    std::array<uint8_t, WATERFALL_MAX_BINS> previous;
+    std::array<uint8_t, WATERFALL_MAX_BINS> current;
+    std::array<uint16_t, WATERFALL_MAX_BINS> residuals;   // zigzag coded
+    std::vector<float> sortBuffer;
+};
+
+#endif // WATERFALL_CODEC_H
@@ -0,0 +1,64 @@
+#include "WaterfallHistory.h"
+#include <algorithm>
+#include <cmath>
+#include "global.h"
+#include "WaterfallCodec.h"
+
+// lines older than this are from an earlier use of the band (no subscribers in between)
+static const auto MAX_LINE_GAP = std::chrono::seconds(1);
+
+WaterfallHistory::WaterfallHistory() : ring(WATERFALL_HISTORY_LINES) {
+}
+
+void WaterfallHistory::addLine(const float *db, uint32_t startQRG) {
+    const unsigned int n = 1024;
+
+    // range like the WaterfallEncoder: 10 dB below the median, 5 dB steps
+    sortBuffer.assign(db, db + n);
+    std::nth_element(sortBuffer.begin(), sortBuffer.begin() + n / 2, sortBuffer.end());
+    float low = std::floor((sortBuffer[n / 2] - 10.0f) / 5.0f) * 5.0f;
+
+    std::lock_guard<std::mutex> lock(mutex);
+    auto now = std::chrono::steady_clock::now();
+    if (startQRG != historyQRG || now - lastLine > MAX_LINE_GAP) {
+        count = 0;
+        historyQRG = startQRG;
+    }
+    lastLine = now;
+
+    Line& line = ring[next];
+    line.low = low;
+    for (unsigned int i = 0; i < n; i++) {
+        float q = (db[i] - low) * 2.0f + 0.5f;
+        line.q[i] = static_cast<uint8_t>(std::min(std::max(q, 0.0f), 255.0f));
+    }
+    next = (next + 1) % WATERFALL_HISTORY_LINES;
+    count = std::min(count + 1, WATERFALL_HISTORY_LINES);
+}
+
+WaterfallBurst WaterfallHistory::getBurst() const {
+    // copy the lines, newest first, and encode them without the lock
+    std::vector<Line> lines;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        bool current = std::chrono::steady_clock::now() - lastLine <= MAX_LINE_GAP;
+        unsigned int num = current ? count : 0;
+        lines.reserve(num);
+        for (unsigned int i = 0; i < num; i++) {
+            lines.push_back(ring[(next + WATERFALL_HISTORY_LINES - 1 - i) % WATERFALL_HISTORY_LINES]);
+        }
+    }
+
+    auto frames = std::make_shared<std::vector<std::string>>();
+    frames->reserve(lines.size());
+    WaterfallEncoder encoder(2);
+    std::array<float, 1025> bins;
+    ClientTXData txdata;
+    for (const Line& line : lines) {
+        bins[0] = 0.0f;
+        for (unsigned int i = 0; i < 1024; i++) bins[i + 1] = line.low + line.q[i] * 0.5f;
+        encoder.encode(bins, txdata);
+        frames->emplace_back(reinterpret_cast<const char*>(txdata.data.data()), txdata.length);
+    }
+    return frames;
+}
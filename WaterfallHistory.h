@@ -0,0 +1,46 @@
+#ifndef WATERFALL_HISTORY_H
+#define WATERFALL_HISTORY_H
+
+#include <array>
+#include <vector>
+#include <string>
+#include <memory>
+#include <mutex>
+#include <chrono>
+#include <cstdint>
+
+// number of lines kept per virtual band, the height of the big waterfall in index.html (30 s)
+const unsigned int WATERFALL_HISTORY_LINES = 300;
+
+// frames of a history burst: compressed waterfall lines (ID 9, waterfall 2) in the legacy layout, newest line first
+typedef std::shared_ptr<const std::vector<std::string>> WaterfallBurst;
+
+// the last wideband lines of a virtual band, 8 bit quantized like the compressed waterfall (0.5 dB steps)
+// written by the FFTProcessor thread, read by the ClientManager for every new client
+class WaterfallHistory {
+public:
+    WaterfallHistory();
+
+    // dB values of a new line (1024 bins), startQRG: start of the band, the history is cleared if it changes
+    void addLine(const float *db, uint32_t startQRG);
+
+    // the lines as a burst for a new client, empty if the band is not running (no current lines)
+    WaterfallBurst getBurst() const;
+
+private:
+    struct Line {
+        float low;      // dB of q = 0
+        std::array<uint8_t, 1024> q;
+    };
+
+    mutable std::mutex mutex;
+    std::vector<Line> ring;
+    unsigned int next = 0;      // slot of the next line
+    unsigned int count = 0;     // valid lines
+    uint32_t historyQRG = 0;
+    std::chrono::steady_clock::time_point lastLine;
+
+    std::vector<float> sortBuffer;
+};
+
+#endif // WATERFALL_HISTORY_H
@@ -3,10 +3,30 @@
 #include <sstream>
 #include <iomanip>
 #include "ClientManager.h"
+#include "WaterfallCodec.h"
 
-boost::lockfree::queue<ClientTXData, boost::lockfree::capacity<100>> websocketTXQueue;
+// frames for many clients, only pushed by the ClientManager thread
+boost::lockfree::spsc_queue<ClientTXData, boost::lockfree::capacity<32>> broadcastQueue;
+std::atomic<uint64_t> broadcastDropped{0};
+// subscription changes, only pushed by the ClientManager thread
+boost::lockfree::spsc_queue<TopicSubscription, boost::lockfree::capacity<100>> subscriptionQueue;
 // Vector to store connected clients
 std::vector<uWS::WebSocket<false, true, PerSocketData>*> clients;
+// the app of the server thread, publishes to the topics
+uWS::App *wsApp = nullptr;
+// event loop of the server thread, woken up by the producers
+std::atomic<uWS::Loop*> wsLoop{nullptr};
+// a processQueue() call is deferred and has not started yet
+std::atomic<bool> wakeupPending{false};
+
+// the waterfall lines of a client are dropped while uWS holds more than this for its socket,
+// so a slow connection does not delay its own audio
+const unsigned int MAX_WATERFALL_BACKLOG = 256 * 1024;
+// the waterfall history is only sent while less than this is waiting, so it never delays the live frames
+const unsigned int MAX_BURST_BACKLOG = 16 * 1024;
+
+// v2 frame which is sent next, only used by the WebSocket thread
+std::string frameBuffer;
 
 // Singleton instance accessor
 WebSocketServer& WebSocketServer::getInstance() {
@@ -19,7 +39,10 @@ void WebSocketServer::startServer() {
 
     std::thread wsThread([this]() {
 
-        uWS::App().ws<PerSocketData>("/*", {
+        uWS::App app;
+        wsApp = &app;
+
+        app.ws<PerSocketData>("/*", {
             .compression = uWS::SHARED_COMPRESSOR,
             .maxPayloadLength = 16 * 1024,
             .idleTimeout = 10,
@@ -35,8 +58,12 @@ void WebSocketServer::startServer() {
                 clientIP = server.ipv6ToIpv4(clientIP);
 
                 // Upgrade the connection and store the client's IP
-                res->template upgrade<PerSocketData>({ clientIP }, req->getHeader("sec-websocket-key"),
-                                                     req->getHeader("sec-websocket-protocol"),
+                // the browser asks for protocol version 2 with the subprotocol, old pages get the legacy frames
+                std::string_view protocols = req->getHeader("sec-websocket-protocol");
+                bool v2 = protocols.find(PROTOCOL_V2_NAME) != std::string_view::npos;
+
+                res->template upgrade<PerSocketData>({ clientIP, 0, nullptr, v2 ? 2 : 1 }, req->getHeader("sec-websocket-key"),
+                                                     v2 ? std::string_view(PROTOCOL_V2_NAME) : protocols,
                                                      req->getHeader("sec-websocket-extensions"), context);
             },
 
@@ -48,6 +75,7 @@ void WebSocketServer::startServer() {
                 }
                 else {
                     clients.push_back(ws);
+                    ws->subscribe(topicName(TOPIC_ALL, ws->getUserData()->protocol));
                     onClientConnect(ws);
                 }
             },
@@ -58,6 +86,10 @@ void WebSocketServer::startServer() {
                 }
             },
 
+            .drain = [this](auto* /*ws*/) {
+                wakeup();   // continue a waterfall history burst
+            },
+
             .close = [this](auto* ws, int /*code*/, std::string_view /*message*/) {
                 auto it = std::remove(clients.begin(), clients.end(), ws);
                 if (it != clients.end()) {
@@ -72,83 +104,187 @@ void WebSocketServer::startServer() {
         }).listen(9001, [this](auto* listen_socket) {
             if (listen_socket) {
             std::cout << "Thread " << std::this_thread::get_id() << " listening on port 9001" << std::endl;
-            // Get the event loop associated with the current thread
-            uWS::Loop *loop = uWS::Loop::get();
-
-            // Cast the uWS loop to a µSockets loop
-            us_loop_t *us_loop = (us_loop_t *)loop;
-
-            // Create a µSockets timer
-            us_timer_t *timer = us_create_timer(us_loop, 0, 0);
-
-            // Set the timer to call the callback every 10ms
-            us_timer_set(timer, [](us_timer_t *t) {
-                processQueue();  // get external data and send it to a client
-            }, 10, 10);
+            // the producers wake up the event loop of this thread (see wakeup()), no polling
+            wsLoop = uWS::Loop::get();
+            wakeup();   // frames which were queued before
         } else {
             std::cerr << "Thread " << std::this_thread::get_id() << " failed to listen on port 9001" << std::endl;
         }
-        }).run();
+        });
+
+        app.run();
     });
 
     wsThread.detach();
 }
 
-// send messages to the browser clients, if available in the websocketTXQueue
+// send the waiting frames to the browser clients, audio before broadcasts before waterfall lines
 void WebSocketServer::processQueue() {
+    // subscriptions first, so a client gets the lines of its new topic which follow
+    TopicSubscription subscription;
+    while (subscriptionQueue.pop(subscription)) {
+        int clientid = subscription.clientId;
+        auto it = std::find_if(clients.begin(), clients.end(), [clientid](uWS::WebSocket<false, true, PerSocketData>* ws) {
+            return ws->getUserData()->clientId == clientid;
+        });
+        if (it == clients.end()) continue;     // already disconnected, uWS removed its subscriptions
+
+        int protocol = (*it)->getUserData()->protocol;
+        if (subscription.oldTopic >= 0) (*it)->unsubscribe(topicName(subscription.oldTopic, protocol));
+        if (subscription.newTopic >= 0) (*it)->subscribe(topicName(subscription.newTopic, protocol));
+    }
+
     ClientTXData item;
 
-    while (!websocketTXQueue.empty()) {
-        websocketTXQueue.pop(item);
-        int clientid = item.clientId;
-        const std::array<float, 1025>& data = item.data;
+    // audio and configuration of every client first
+    for (auto *ws : clients) {
+        ClientTXQueue *txQueue = ws->getUserData()->txQueue.get();
+        if (!txQueue) continue;
+        // corked: the frames of the batch go out with one syscall
+        ws->cork([ws, txQueue, &item]() {
+            while (txQueue->pop(item, ClientTXQueue::AUDIO)) {
+                sendToClient(ws, item);
+            }
+        });
+    }
+
+    // then the frames for many clients, framed once by uWS
+    while (broadcastQueue.pop(item)) {
+        int topic = item.topic >= 0 ? item.topic : TOPIC_ALL;
+        size_t length = std::min<size_t>(item.length, item.data.size() * sizeof(float));
+        std::string_view dataBytes(reinterpret_cast<const char*>(item.data.data()), length);
+        if (!wsApp) continue;
+
+        // only to the protocols which have subscribers, usually all clients use the same one
+        const std::string& topicV1 = topicName(topic, 1);
+        if (wsApp->numSubscribers(topicV1) > 0) {
+            wsApp->publish(topicV1, dataBytes, uWS::OpCode::BINARY);
+        }
+
+        // once more for the v2 clients, the sequence counts the frames of the topic
+        static uint16_t topicSequence[NUM_TOPICS] = {};
+        const std::string& topicV2 = topicName(topic, 2);
+        if (wsApp->numSubscribers(topicV2) > 0) {
+            encodeFrameV2(item, PROTOCOL_FLAG_PUBLISHED, topicSequence[topic]++, frameBuffer);
+            wsApp->publish(topicV2, frameBuffer, uWS::OpCode::BINARY);
+        }
+    }
 
-        if (clientid == -1) {
-            // send message to all clients
-            for (auto *ws : clients) {
-                std::string_view dataBytes(reinterpret_cast<const char*>(data.data()), data.size() * sizeof(float));
-                ws->send(dataBytes, uWS::OpCode::BINARY);
+    // waterfall lines last, only to clients which can keep up
+    for (auto *ws : clients) {
+        ClientTXQueue *txQueue = ws->getUserData()->txQueue.get();
+        if (!txQueue) continue;
+        if (ws->getBufferedAmount() > MAX_WATERFALL_BACKLOG) {
+            txQueue->discard(ClientTXQueue::WATERFALL);
+            txQueue->discard(ClientTXQueue::WINDOW);
+            continue;
+        }
+        ws->cork([ws, txQueue, &item]() {
+            while (txQueue->pop(item, ClientTXQueue::WATERFALL)) {
+                sendToClient(ws, item);
             }
-        } else {
-            // send message to clientid
-            auto it = std::find_if(clients.begin(), clients.end(), [clientid](uWS::WebSocket<false, true, PerSocketData>* ws) {
-                return ws->getUserData()->clientId == clientid;
-            });
-
-            if (it != clients.end()) {
-                bool auth = item.authenticated;
-                if(auth) {
-                    // authentication ok
-                    // send data
-                    uWS::WebSocket<false, true, PerSocketData>* ws = *it;
-                    std::string_view dataBytes(reinterpret_cast<const char*>(data.data()), data.size() * sizeof(float));
-                    ws->send(dataBytes, uWS::OpCode::BINARY);
-                } else {
-                    // authentication failed
-                    std::array<float, 1025UL> msg = {5};    
-                    uWS::WebSocket<false, true, PerSocketData>* ws = *it;
-                    std::string_view dataBytes(reinterpret_cast<const char*>(msg.data()), msg.size() * sizeof(float));
-                    ws->send(dataBytes, uWS::OpCode::BINARY);
-                }
+            while (txQueue->pop(item, ClientTXQueue::WINDOW)) {
+                sendToClient(ws, item);
+            }
+        });
+    }
+
+    // waterfall history of new clients, only as far as the socket is idle
+    for (auto *ws : clients) {
+        ClientTXQueue *txQueue = ws->getUserData()->txQueue.get();
+        if (!txQueue) continue;
+        std::string_view frame;
+        while (ws->getBufferedAmount() < MAX_BURST_BACKLOG && txQueue->nextBurstFrame(frame)) {
+            if (ws->getUserData()->protocol == 2) {
+                // the burst is in the legacy layout: the v2 header replaces the float ID
+                encodeHeaderV2(static_cast<uint8_t>(WATERFALL_ID_ENCODED), 0, ws->getUserData()->sequence++, frameBuffer);
+                frameBuffer.append(frame.substr(sizeof(float)));
+                ws->send(frameBuffer, uWS::OpCode::BINARY);
             } else {
-                std::cerr << "Client with ID " << clientid << " not found." << std::endl;
+                ws->send(frame, uWS::OpCode::BINARY);
             }
         }
     }
 }
 
-void WebSocketServer::sendDataToClient(ClientTXData &data) {
-    if (!websocketTXQueue.push(data)) {
-        std::cerr << "Queue is full, could not push data." << std::endl;
+void WebSocketServer::sendToClient(uWS::WebSocket<false, true, PerSocketData>* ws, const ClientTXData &item) {
+    PerSocketData *socketData = ws->getUserData();
+    if (socketData->protocol == 2) {
+        if (item.authenticated) {
+            encodeFrameV2(item, 0, socketData->sequence++, frameBuffer);
+        } else {
+            ClientTXData authFailed;
+            authFailed.data[0] = 5;
+            encodeFrameV2(authFailed, 0, socketData->sequence++, frameBuffer);
+        }
+        ws->send(frameBuffer, uWS::OpCode::BINARY);
+        return;
+    }
+
+    if (item.authenticated) {
+        // authentication ok
+        // send data
+        size_t length = std::min<size_t>(item.length, item.data.size() * sizeof(float));
+        std::string_view dataBytes(reinterpret_cast<const char*>(item.data.data()), length);
+        ws->send(dataBytes, uWS::OpCode::BINARY);
+    } else {
+        // authentication failed
+        std::array<float, 1025UL> msg = {5};
+        std::string_view dataBytes(reinterpret_cast<const char*>(msg.data()), msg.size() * sizeof(float));
+        ws->send(dataBytes, uWS::OpCode::BINARY);
+    }
+}
+
+const std::string& WebSocketServer::topicName(int topic, int protocol) {
+    // built once, processQueue needs the names of every published frame
+    static const auto names = [] {
+        std::array<std::array<std::string, 2>, NUM_TOPICS> table;
+        for (int t = 0; t < NUM_TOPICS; t++) {
+            std::string name;
+            if (t == TOPIC_ALL) {
+                name = "all";
+            } else if (t >= carrierTopic(0)) {
+                name = "cr" + std::to_string(t - carrierTopic(0));
+            } else {
+                int vband = (t - 1) / 2;
+                name = "wf" + std::to_string(vband) + (((t - 1) % 2) ? "c" : "");
+            }
+            table[t][0] = name;
+            table[t][1] = name + "/2";
+        }
+        return table;
+    }();
+    return names[topic][protocol == 2 ? 1 : 0];
+}
+
+void WebSocketServer::changeSubscription(const TopicSubscription &subscription) {
+    if (subscriptionQueue.push(subscription)) {
+        wakeup();
+    } else {
+        std::cerr << "Subscription queue is full, could not push data." << std::endl;
     }
 }
 
-void WebSocketServer::sendDataToClient(const std::array<float, 1025> &data, int clientid) {
-    ClientTXData txdata;
-    std::memcpy(txdata.data.data(), data.data(), 1025 * sizeof(float));
-    txdata.clientId = clientid;
-    if (!websocketTXQueue.push(txdata)) {
-        std::cerr << "Queue is full, could not push data." << std::endl;
+// called by any thread after frames were queued, the WebSocket thread runs processQueue() as soon as possible
+// only the first call until processQueue() starts defers it, so a burst of frames is sent in one batch
+void WebSocketServer::wakeup() {
+    uWS::Loop *loop = wsLoop;
+    if (!loop) return;  // not listening yet
+    if (wakeupPending.exchange(true)) return;
+    loop->defer([]() {
+        wakeupPending = false;  // frames queued from now on need a new wakeup
+        processQueue();
+    });
+}
+
+void WebSocketServer::broadcast(const ClientTXData &data) {
+    if (broadcastQueue.push(data)) {
+        wakeup();
+    } else {
+        // only log now and then, a full queue means the WebSocket thread is blocked
+        if (broadcastDropped++ % 100 == 0) {
+            std::cerr << "Broadcast queue is full, frames dropped: " << broadcastDropped << std::endl;
+        }
     }
 }
 
@@ -157,6 +293,7 @@ void WebSocketServer::onClientConnect(uWS::WebSocket<false, true, PerSocketData>
 
     // Assign a unique client ID
     ws->getUserData()->clientId = nextClientId++;
+    ws->getUserData()->txQueue = std::make_shared<ClientTXQueue>(ws->getUserData()->clientId);
     
     const std::string& clientIP = ws->getUserData()->clientIP;
     std::cout << "Client connected: " << clientIP << " with client ID: " << ws->getUserData()->clientId << std::endl;
@@ -166,6 +303,7 @@ void WebSocketServer::onClientConnect(uWS::WebSocket<false, true, PerSocketData>
     info.clientIP = clientIP;
     info.clientId = ws->getUserData()->clientId;  // Use the assigned client ID
     info.messageId = 0;                           // Connection event
+    info.txQueue = ws->getUserData()->txQueue;    // the ClientObject sends through this queue
 
 
     // Push into the queue using ClientManager's enqueue method
@@ -179,6 +317,11 @@ void WebSocketServer::onClientDisconnect(uWS::WebSocket<false, true, PerSocketDa
     int clientId = ws->getUserData()->clientId;
     std::string clientIP = ws->getUserData()->clientIP;
     std::cout << "Client disconnected: " << clientIP << " with client ID: " << clientId << std::endl;
+    if (ClientTXQueue *txQueue = ws->getUserData()->txQueue.get()) {
+        std::cout << "Frames dropped, audio: " << txQueue->getDropped(ClientTXQueue::AUDIO)
+                  << " waterfall: " << txQueue->getDropped(ClientTXQueue::WATERFALL)
+                  << " window: " << txQueue->getDropped(ClientTXQueue::WINDOW) << std::endl;
+    }
 
     // Create ClientInfo for disconnection
     ClientInfo info;
@@ -197,11 +340,17 @@ void WebSocketServer::onClientDisconnect(uWS::WebSocket<false, true, PerSocketDa
 void WebSocketServer::onClientMessage(uWS::WebSocket<false, true, PerSocketData>* ws, std::string_view message) {
     int clientId = ws->getUserData()->clientId;
 
-    size_t numBytes = message.size();
-    size_t numFloats = numBytes / sizeof(float);
-
-    std::vector<float> data(numFloats);
-    std::memcpy(data.data(), message.data(), numBytes);
+    std::vector<float> data;
+    if (ws->getUserData()->protocol == 2) {
+        if (!decodeMessageV2(message, data)) {
+            std::cerr << "Invalid message from client " << clientId << std::endl;
+            return;
+        }
+    } else {
+        size_t numFloats = message.size() / sizeof(float);
+        data.resize(numFloats);
+        std::memcpy(data.data(), message.data(), numFloats * sizeof(float));
+    }
 
     // Create ClientInfo for message
     ClientInfo info;
@@ -11,11 +11,33 @@
 #include <boost/lockfree/spsc_queue.hpp>
 #include <boost/lockfree/queue.hpp>
 #include "global.h"
+#include "VirtualBands.h"
+#include "ClientTXQueue.h"
+#include "Protocol.h"
 
 // Per-socket data (can be used to store state for each connection)
 struct PerSocketData {
     std::string clientIP;  // Store the client's IP address or other information
     int clientId;          // Unique client identifier
+    std::shared_ptr<ClientTXQueue> txQueue;    // outbound frames, filled by the ClientObject
+    int protocol = 1;      // 1: legacy float frames, 2: see Protocol.h
+    uint16_t sequence = 0; // of the v2 frames sent to this client
+};
+
+// topics: frames which are the same for many clients are framed (and compressed) once by uWS
+// and published to all subscribers, instead of a send() per client
+const int TOPIC_ALL = 0;    // every client, e.g. the user list (clientId -1)
+// wideband waterfall of a virtual band, float (ID 0) or compressed (ID 9) format
+inline int waterfallTopic(int vband, bool compressed) { return 1 + vband * 2 + (compressed ? 1 : 0); }
+// carrier list (ID 10) of a virtual band
+inline int carrierTopic(int vband) { return 1 + MAX_VBANDS * 2 + vband; }
+const int NUM_TOPICS = 1 + MAX_VBANDS * 3;
+
+// request of the ClientManager to move a client from one topic to another (-1: none)
+struct TopicSubscription {
+    int clientId;
+    int oldTopic;
+    int newTopic;
 };
 
 // Singleton WebSocket Server class
@@ -27,9 +49,16 @@ public:
     // Starts the WebSocket server
     void startServer();
 
-    // Sends data to a specific client
-    void sendDataToClient(ClientTXData &data);
-    void sendDataToClient(const std::array<float, 1025> &data, int clientid = -1);
+    // Sends data to all subscribers of data.topic (all clients if clientId is -1)
+    // single producer: only called by the ClientManager thread
+    // the frames of a specific client go through its ClientTXQueue
+    void broadcast(const ClientTXData &data);
+
+    // wake up the WebSocket thread after frames were pushed into a ClientTXQueue, can be called by any thread
+    void wakeup();
+
+    // subscribe a client to a topic, in the order of the calls
+    void changeSubscription(const TopicSubscription &subscription);
 
 private:
     // Constructor is private to enforce singleton pattern
@@ -55,6 +84,12 @@ private:
     // read external data from the queue and send it to a specific or all clients
     static void processQueue();
 
+    // uWS topic name of a topic number, the clients of each protocol have their own topics
+    static const std::string& topicName(int topic, int protocol);
+
+    // send a frame of a client, or the authentication failure message
+    static void sendToClient(uWS::WebSocket<false, true, PerSocketData>* ws, const ClientTXData &item);
+
     // Client ID generator
     int nextClientId;
 };
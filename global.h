@@ -3,31 +3,33 @@
 
 #include <vector>
 #include <string>
+#include <array>
+#include <complex>
+#include <memory>
 #include "liquid.h"
+#include "SampleBlock.h"
 
-// structure to hold raw samples
-// already converted into liquid DSP format
-typedef struct {
-    std::vector<liquid_float_complex> sdata;
-    int numSamples;
-} SampleData;
+class ClientTXQueue;
 
 struct ClientInfo {
     std::string clientIP;             // IP address of the client
     int clientId;                // Unique identifier for each client (not IP)
     int messageId;               // 0 = connect, 1 = disconnect, 2 = message, 3= raw data
     std::vector<float> message;  // Data vector (for message events)
-    std::vector<liquid_float_complex> sdata;    // raw data (if messageID == 3)
+    SampleBlockPtr samples;      // shared Channelizer spectrum (if messageID == 3) or baseband samples
+    std::shared_ptr<ClientTXQueue> txQueue;   // outbound frames of the client (if messageID == 0)
 };
 
 struct ClientTXData {
     int clientId;
     bool authenticated = true;
     std::array<float, 1025> data;
+    unsigned int length = 1025 * sizeof(float);    // number of bytes sent, less for short or encoded audio frames
+    int topic = -1;     // >= 0: published once to all subscribers of this topic (see WebSocketServer.h), clientId is not used
 };
 
 // Start frequencies (in Hz) for each ham radio band
-const uint32_t start_630m = 400000;    // 472 kHz
+const uint32_t start_630m = 472000;    // 472 kHz
 const uint32_t start_160m = 1800000;   // 1.8 MHz
 const uint32_t start_80m = 3500000;    // 3.5 MHz
 const uint32_t start_60m = 5300000;    
@@ -51,7 +53,7 @@ const uint32_t start_70cm = 433500000; // 430 MHz
 const uint32_t start_70cm_a = 438800000;
 const uint32_t start_PMR446 = 446000000;
 
-const uint32_t end_630m = 500000;     // 479 kHz (breit genug machen, sonst Probleme mit der fft)
+const uint32_t end_630m = 479000;     // 479 kHz, the FFTProcessor decimates narrow bands to their span
 const uint32_t end_160m = 2000000;    // 2.0 MHz
 const uint32_t end_80m = 3800000;     // 3.8 MHz
 const uint32_t end_60m = 5400000;     
@@ -75,10 +77,9 @@ const uint32_t end_70cm = 434000000; // 430 MHz
 const uint32_t end_70cm_a = 439300000;
 const uint32_t end_PMR446 = 446200000;
 
-// curently used frequencies
-extern uint32_t StartQRG;
-extern uint32_t EndQRG;
 extern bool keeprunning;
+extern bool narrowFromWideband;     // small waterfall sliced from the big FFT instead of a FFT per client
+extern unsigned int agcLookaheadMs; // audio delay, the AGC reduces the gain before a loud signal arrives
 extern const long unsigned int max_users;
 
 #endif // GLOBALS_H
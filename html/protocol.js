@@ -0,0 +1,109 @@
+// WebSocket protocol version 2, format see Protocol.h
+// the page asks for it with the WebSocket subprotocol, pages without it get the legacy float frames
+
+const PROTOCOL_V2 = "kwsdr.v2";
+const PROTOCOL_HEADER_SIZE = 8;
+
+let clientSequence = 0;
+
+// carrier list (type 10), same payload in both protocols:
+// number of carriers, then frequency (Hz above the band start), bandwidth (Hz) and SNR (dB) of each
+function parseCarriers(view, offset) {
+    const carriers = [];
+    const num = Math.round(view.getFloat32(offset, true));
+    for (let i = 0; i < num && offset + 16 + 12 * i <= view.byteLength; i++) {
+        const pos = offset + 4 + 12 * i;
+        carriers.push({
+            frequency: view.getFloat32(pos, true),
+            bandwidth: view.getFloat32(pos + 4, true),
+            snr: view.getFloat32(pos + 8, true)
+        });
+    }
+    return carriers;
+}
+
+// type of a frame of the server and the position of its payload in data
+// the configuration (legacy order: center, shift, mode, start, end, users, bands),
+// the user list and the carrier list are decoded for both protocols
+function parseServerFrame(data, v2) {
+    const view = new DataView(data);
+
+    if (!v2) {
+        const msg = { type: Math.round(view.getFloat32(0, true)), offset: 4 };
+        if (msg.type === 10) msg.carriers = parseCarriers(view, 4);
+        if (msg.type === 2) msg.config = new Float32Array(data, 4, 1024);
+        if (msg.type === 4) {
+            const chars = new Float32Array(data, 4, (data.byteLength - 4) / 4);
+            msg.users = "";
+            for (let i = 0; i < chars.length && chars[i] !== 0; i++) {
+                msg.users += String.fromCharCode(Math.round(chars[i]));
+            }
+        }
+        return msg;
+    }
+
+    const msg = {
+        type: view.getUint8(0),
+        flags: view.getUint8(1),
+        sequence: view.getUint16(2, true),
+        time: view.getUint32(4, true),
+        offset: PROTOCOL_HEADER_SIZE
+    };
+    if (msg.type === 2) {
+        msg.config = [
+            view.getUint32(8, true),        // center
+            view.getFloat32(20, true),      // shift
+            view.getUint8(26),              // mode
+            view.getUint32(12, true),       // start
+            view.getUint32(16, true),       // end
+            view.getUint16(24, true)        // users
+        ];
+        const numBands = view.getUint8(27);
+        for (let i = 0; i < numBands; i++) msg.config.push(view.getUint16(28 + 2 * i, true));
+    }
+    if (msg.type === 4) {
+        msg.users = new TextDecoder().decode(new Uint8Array(data, PROTOCOL_HEADER_SIZE));
+    }
+    if (msg.type === 10) msg.carriers = parseCarriers(view, PROTOCOL_HEADER_SIZE);
+    return msg;
+}
+
+// message to the server: value is a number (type 0: float, others: integer), the text of type 4
+// or [start, span, width] of type 8
+function buildClientMessage(type, value, v2) {
+    if (!v2) {
+        if (type === 4) {
+            const bytes = new TextEncoder().encode(value);
+            const floatArray = new Float32Array(bytes.length + 1);
+            floatArray[0] = 4;
+            for (let i = 0; i < bytes.length; i++) floatArray[i + 1] = bytes[i];
+            return floatArray.buffer;
+        }
+        if (type === 8) return new Float32Array([8, ...value]).buffer;
+        return new Float32Array([type, value]).buffer;
+    }
+
+    let buffer;
+    if (type === 4) {
+        const bytes = new TextEncoder().encode(value);
+        buffer = new ArrayBuffer(PROTOCOL_HEADER_SIZE + bytes.length);
+        new Uint8Array(buffer, PROTOCOL_HEADER_SIZE).set(bytes);
+    } else if (type === 8) {
+        // value: [start Hz, span Hz, width]
+        buffer = new ArrayBuffer(PROTOCOL_HEADER_SIZE + 12);
+        const view = new DataView(buffer);
+        view.setFloat32(PROTOCOL_HEADER_SIZE, value[0], true);
+        view.setFloat32(PROTOCOL_HEADER_SIZE + 4, value[1], true);
+        view.setInt32(PROTOCOL_HEADER_SIZE + 8, Math.round(value[2]), true);
+    } else {
+        buffer = new ArrayBuffer(PROTOCOL_HEADER_SIZE + 4);
+        const view = new DataView(buffer);
+        if (type === 0) view.setFloat32(PROTOCOL_HEADER_SIZE, value, true);
+        else view.setInt32(PROTOCOL_HEADER_SIZE, Math.round(value), true);
+    }
+    const view = new DataView(buffer);
+    view.setUint8(0, type);
+    view.setUint16(2, clientSequence, true);
+    clientSequence = (clientSequence + 1) & 0xFFFF;
+    return buffer;
+}
@@ -0,0 +1,81 @@
+// decoder for the compressed waterfall lines (ID 9), format see WaterfallCodec.h
+// one WaterfallDecoder per waterfall, decode() returns the dB values or null
+// if the line cannot be decoded (a line was lost, wait for the next keyframe)
+
+const WATERFALL_CODEC_VERSION = 1;
+const WATERFALL_HEADER_SIZE = 20;
+const WATERFALL_RICE_ESCAPE = 16;
+
+// offset: 0 for the legacy frames, 4 for protocol v2 (the 8 byte header replaces the float ID)
+
+// which waterfall (0 = wideband, 1 = narrow, 2 = wideband history) an encoded line belongs to
+function waterfallOfLine(data, offset = 0) {
+    return new DataView(data).getUint8(offset + 5);
+}
+
+class WaterfallDecoder {
+    constructor() {
+        this.previous = null;
+        this.sequence = -1;
+    }
+
+    decode(data, offset = 0) {
+        const view = new DataView(data, offset);
+        if (view.getUint8(4) !== WATERFALL_CODEC_VERSION) return null;
+
+        const flags = view.getUint8(6);
+        const sequence = view.getUint8(7);
+        const low = view.getFloat32(8, true);
+        const step = view.getFloat32(12, true);
+        const numBins = view.getUint16(16, true);
+        const k = view.getUint8(18);
+        const keyframe = (flags & 1) !== 0;
+
+        const expected = (this.sequence + 1) & 0xFF;
+        this.sequence = sequence;
+        if (!keyframe && (this.previous === null || this.previous.length !== numBins || sequence !== expected)) {
+            this.previous = null;
+            return null;
+        }
+
+        const bytes = new Uint8Array(data, offset + WATERFALL_HEADER_SIZE);
+        const q = new Uint8Array(numBins);
+
+        if (flags & 2) {
+            // raw 8 bit values
+            q.set(bytes.subarray(0, numBins));
+        } else {
+            let pos = 0;    // bit position
+            const readBit = () => {
+                const bit = (bytes[pos >> 3] >> (7 - (pos & 7))) & 1;
+                pos++;
+                return bit;
+            };
+            const readBits = (n) => {
+                let v = 0;
+                for (let i = 0; i < n; i++) v = (v << 1) | readBit();
+                return v;
+            };
+
+            for (let i = 0; i < numBins; i++) {
+                let u = 0;
+                while (u < WATERFALL_RICE_ESCAPE && readBit() === 1) u++;
+                let z;
+                if (u >= WATERFALL_RICE_ESCAPE) {
+                    z = readBits(9);
+                } else {
+                    z = (u << k) | readBits(k);
+                }
+                const r = (z & 1) ? -((z + 1) >> 1) : (z >> 1);
+                const ref = keyframe ? (i > 0 ? q[i - 1] : 0) : this.previous[i];
+                q[i] = ref + r;
+            }
+        }
+
+        this.previous = q;
+
+        const db = new Float32Array(numBins);
+        for (let i = 0; i < numBins; i++) db[i] = low + q[i] * step;
+        return db;
+    }
+}
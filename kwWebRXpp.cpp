@@ -1,33 +1,85 @@
 #include "SDRHardware.h"
+#include "IngestProcessor.h"
 #include "FFTProcessor.h"
+#include "FFTPlanCache.h"
 #include "WebSocketServer.h"
 #include "ClientManager.h"
+#include "DSPThreadPool.h"
+#include "FileSource.h"
+#include "SyntheticSource.h"
+#include "AGC.h"
 #include "global.h"
+#include <unistd.h>
+#include <algorithm>
 
 bool keeprunning = true;
-uint32_t StartQRG = start_20m;
-uint32_t EndQRG = end_20m;
+bool narrowFromWideband = false;
+unsigned int agcLookaheadMs = 0;
 
 // maximum nunber of allowed users
 const long unsigned int max_users = 20;
 
-int main() {
+static void usage(const char *name) {
+    printf("usage: %s [-f file [-l]] [-s] [-x] [-n] [-a ms]\n", name);
+    printf("  (no option)  receive with the SDRplay RSP\n");
+    printf("  -f file      replay a 2.4 MS/s I/Q recording (raw interleaved int16 or 16 bit stereo WAV)\n");
+    printf("  -l           replay the file in an endless loop\n");
+    printf("  -s           generate a synthetic test signal\n");
+    printf("  -x           file/synthetic: as fast as possible instead of real time\n");
+    printf("  -n           small waterfall from the big FFT (no FFT and thread per client)\n");
+    printf("  -a ms        AGC lookahead 0...%u ms (audio is delayed by this time)\n", AGC::MAX_LOOKAHEAD_MS);
+}
+
+int main(int argc, char *argv[]) {
+    std::string replayFile;
+    bool synthetic = false;
+    bool loop = false;
+    bool realtime = true;
+    int opt;
+    while ((opt = getopt(argc, argv, "f:lsxna:h")) != -1) {
+        switch (opt) {
+            case 'f': replayFile = optarg; break;
+            case 'l': loop = true; break;
+            case 's': synthetic = true; break;
+            case 'x': realtime = false; break;
+            case 'n': narrowFromWideband = true; break;
+            case 'a': agcLookaheadMs = std::min((unsigned int)atoi(optarg), AGC::MAX_LOOKAHEAD_MS); break;
+            default: usage(argv[0]); exit(0);
+        }
+    }
+
+    // measured FFT plans for all sizes, before any FFT user is created
+    FFTPlanCache::getInstance().planAll();
+
+    // the ingest thread must run before the SDR delivers samples
+    IngestProcessor::getInstance().startIngestThread();
+
     // Create an object of SDRHardware
     SDRHardware& hardware = SDRHardware::getInstance();
+    if (!replayFile.empty()) {
+        hardware.setSource(std::make_unique<FileSource>(replayFile, realtime, loop));
+    } else if (synthetic) {
+        hardware.setSource(std::make_unique<SyntheticSource>(realtime));
+    }
     bool ret = hardware.init();
     if(!ret) {
         printf("cannot init SDR hardware\n");
         exit(0);
     }
 
-    FFTProcessor::getInstance().startFFTThread();
+    // one waterfall per virtual band
+    for (int vband = 0; vband < MAX_VBANDS; vband++) {
+        FFTProcessor::getInstance(vband).startFFTThread();
+    }
     WebSocketServer::getInstance().startServer();
+    // the demodulation of all clients runs on one worker per core
+    DSPThreadPool::getInstance().start();
     ClientManager::getInstance().startProcessing();
 
-    // Endless loop
-    while (true) {
+    // Endless loop, wakes up only for band changes
+    while (keeprunning) {
+        hardware.waitForBandChange();
         hardware.changeBand();
-        usleep(100);
     }
 
     return 0;